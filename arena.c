@@ -0,0 +1,137 @@
+/*
+ * LIWIT - Linux-Windows Text Editor
+ * Copyright (C) 2026  Khud Bakhtiyar Iqbal Sofi
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include "arena.h"
+
+struct ArenaSlab {
+    ArenaSlab *next;
+    size_t pad;                // Keeps the pieces 16-byte aligned
+};
+
+struct ArenaBig {
+    ArenaBig *prev;
+    ArenaBig *next;
+};
+
+// SIZE CLASSES
+static int size_class(int size) {
+    int c = 0;
+    while ((ARENA_MIN_CLASS << c) < size) c++;
+    return c;
+}
+
+// INITIALIZATION & CLEANUP
+void arena_init(Arena *arena) {
+    memset(arena, 0, sizeof(Arena));
+}
+
+// Free everything at once: one munmap per slab, whatever it holds.
+void arena_release(Arena *arena) {
+    for (ArenaSlab *s = arena->slabs; s; ) {
+        ArenaSlab *next = s->next;
+        munmap(s, ARENA_SLAB_SIZE);
+        s = next;
+    }
+    for (ArenaBig *b = arena->big; b; ) {
+        ArenaBig *next = b->next;
+        free(b);
+        b = next;
+    }
+    arena_init(arena);
+}
+
+// ALLOCATION
+static void *slab_cut(Arena *arena, int size) {
+    if (!arena->slabs || arena->slab_used + size > ARENA_SLAB_SIZE) {
+        ArenaSlab *s = (ArenaSlab *)mmap(NULL, ARENA_SLAB_SIZE,
+                                         PROT_READ | PROT_WRITE,
+                                         MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (s == MAP_FAILED) return NULL;
+        s->next = arena->slabs;
+        arena->slabs = s;
+        arena->slab_used = sizeof(ArenaSlab);
+        arena->mapped += ARENA_SLAB_SIZE;
+    }
+    void *p = (char *)arena->slabs + arena->slab_used;
+    arena->slab_used += size;
+    return p;
+}
+
+// At least `size` bytes. The size actually reserved, which is what
+// arena_free() must be given back, is stored in *cap.
+void *arena_alloc(Arena *arena, int size, int *cap) {
+    if (size <= ARENA_MAX_CLASS) {
+        int c = size_class(size);
+        *cap = ARENA_MIN_CLASS << c;
+        void *p = arena->free[c];
+        if (p) {
+            arena->free[c] = *(void **)p;
+            return p;
+        }
+        return slab_cut(arena, *cap);
+    }
+
+    ArenaBig *b = (ArenaBig *)malloc(sizeof(ArenaBig) + size);
+    b->prev = NULL;
+    b->next = arena->big;
+    if (arena->big) arena->big->prev = b;
+    arena->big = b;
+    arena->big_bytes += size;
+    *cap = size;
+    return b + 1;
+}
+
+// Move the first len bytes of p into a piece of at least `size` bytes.
+void *arena_grow(Arena *arena, void *p, int len, int old_cap, int size,
+                 int *cap) {
+    if (old_cap > ARENA_MAX_CLASS && size > ARENA_MAX_CLASS) {
+        ArenaBig *b = (ArenaBig *)p - 1;
+        b = (ArenaBig *)realloc(b, sizeof(ArenaBig) + size);
+        if (b->prev) b->prev->next = b;
+        else arena->big = b;
+        if (b->next) b->next->prev = b;
+        arena->big_bytes += size - old_cap;
+        *cap = size;
+        return b + 1;
+    }
+
+    void *q = arena_alloc(arena, size, cap);
+    if (len > 0) memcpy(q, p, len);
+    arena_free(arena, p, old_cap);
+    return q;
+}
+
+void arena_free(Arena *arena, void *p, int cap) {
+    if (!p) return;
+    if (cap <= ARENA_MAX_CLASS) {
+        int c = size_class(cap);
+        *(void **)p = arena->free[c];
+        arena->free[c] = p;
+        return;
+    }
+
+    ArenaBig *b = (ArenaBig *)p - 1;
+    if (b->prev) b->prev->next = b->next;
+    else arena->big = b->next;
+    if (b->next) b->next->prev = b->prev;
+    arena->big_bytes -= cap;
+    free(b);
+}
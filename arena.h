@@ -0,0 +1,66 @@
+/*
+ * LIWIT - Linux-Windows Text Editor
+ * Copyright (C) 2026  Khud Bakhtiyar Iqbal Sofi
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Storage for the text of edited lines.
+ *
+ * Requests up to ARENA_MAX_CLASS bytes are rounded up to a power of two
+ * and carved out of large mmap'd slabs; a freed piece goes on the free
+ * list of its size class and is handed out again before the slab grows.
+ * There is no per-allocation header, so a short line costs its size
+ * class and nothing more. Larger requests get a malloc'd block of their
+ * own, linked into a list.
+ *
+ * Pieces are freed one at a time as lines change, but the arena as a
+ * whole goes away with arena_release(), which unmaps the slabs without
+ * looking at the lines in them.
+ */
+
+#ifndef LIWIT_ARENA_H
+#define LIWIT_ARENA_H
+
+#include <stddef.h>
+
+// CONFIGURATION
+#define ARENA_SLAB_SIZE (1 << 20)  // Bytes mapped at a time
+#define ARENA_MIN_CLASS 16         // Smallest piece
+#define ARENA_CLASSES 9            // Size classes: 16, 32, ... 4096 bytes
+#define ARENA_MAX_CLASS (ARENA_MIN_CLASS << (ARENA_CLASSES - 1))
+
+// DATA STRUCTURES
+typedef struct ArenaSlab ArenaSlab;
+typedef struct ArenaBig ArenaBig;
+
+typedef struct {
+    ArenaSlab *slabs;          // Newest first; pieces are cut from the head
+    size_t slab_used;          // Bytes cut from the head slab
+    void *free[ARENA_CLASSES]; // Freed pieces of each class
+    ArenaBig *big;             // Blocks larger than ARENA_MAX_CLASS
+    size_t mapped;             // Bytes in slabs
+    size_t big_bytes;          // Bytes in large blocks
+} Arena;
+
+// PROTOTYPES
+void arena_init(Arena *arena);
+void arena_release(Arena *arena);
+void *arena_alloc(Arena *arena, int size, int *cap);
+void *arena_grow(Arena *arena, void *p, int len, int old_cap, int size,
+                 int *cap);
+void arena_free(Arena *arena, void *p, int cap);
+
+#endif
@@ -0,0 +1,1320 @@
+/*
+ * LIWIT - Linux-Windows Text Editor
+ * Copyright (C) 2026  Khud Bakhtiyar Iqbal Sofi
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <limits.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include "buffer.h"
+
+// BLOCK INDEX (Fenwick tree over block sizes)
+// The block array has a gap of empty slots where blocks were last added
+// or removed, so splitting a block near the cursor moves no other block
+// pointers. The tree covers every slot; those in the gap hold 0 lines.
+static int gap_len(Buffer *buf) {
+    return buf->block_cap - buf->block_count;
+}
+
+// Slot of block k.
+static int slot(Buffer *buf, int k) {
+    return k < buf->gap ? k : k + gap_len(buf);
+}
+
+static void tree_rebuild(Buffer *buf) {
+    int n = buf->block_cap;
+    int gap_end = buf->gap + gap_len(buf);
+    for (int i = 1; i <= n; i++) {
+        int in_gap = i - 1 >= buf->gap && i - 1 < gap_end;
+        buf->tree[i] = in_gap ? 0 : buf->blocks[i - 1]->count;
+    }
+    for (int i = 1; i <= n; i++) {
+        int parent = i + (i & -i);
+        if (parent <= n) buf->tree[parent] += buf->tree[i];
+    }
+}
+
+static void tree_add_slot(Buffer *buf, int s, int delta) {
+    for (int i = s + 1; i <= buf->block_cap; i += i & -i) {
+        buf->tree[i] += delta;
+    }
+}
+
+static void tree_add(Buffer *buf, int b, int delta) {
+    tree_add_slot(buf, slot(buf, b), delta);
+}
+
+// Find the block holding line y; *off receives the index inside it.
+// y == line_count maps to the end of the last block.
+int buffer_locate(Buffer *buf, int y, int *off) {
+    if (y >= buf->line_count) {
+        int b = buf->block_count - 1;
+        *off = buffer_block(buf, b)->count;
+        return b;
+    }
+
+    int step = 1;
+    while (step * 2 <= buf->block_cap) step *= 2;
+
+    int pos = 0;
+    int rem = y;
+    for (; step > 0; step >>= 1) {
+        if (pos + step <= buf->block_cap && buf->tree[pos + step] <= rem) {
+            pos += step;
+            rem -= buf->tree[pos];
+        }
+    }
+    *off = rem;
+    return pos < buf->gap ? pos : pos - gap_len(buf);
+}
+
+// BLOCK MANAGEMENT
+static void blocks_reserve(Buffer *buf, int need) {
+    if (need <= buf->block_cap) return;
+    int cap = buf->block_cap ? buf->block_cap * 2 : 8;
+    while (cap < need) cap *= 2;
+
+    // Blocks after the gap stay at the end of the array.
+    int tail = buf->block_count - buf->gap;
+    buf->blocks = (LineBlock **)realloc(buf->blocks, cap * sizeof(LineBlock *));
+    memmove(&buf->blocks[cap - tail], &buf->blocks[buf->block_cap - tail],
+            tail * sizeof(LineBlock *));
+    buf->tree = (int *)realloc(buf->tree, (cap + 1) * sizeof(int));
+    buf->block_cap = cap;
+    tree_rebuild(buf);
+}
+
+// Move the gap to just before block k. A short move updates the tree
+// block by block; a long one rebuilds it.
+static void gap_move(Buffer *buf, int k) {
+    int len = gap_len(buf);
+    int n = k < buf->gap ? buf->gap - k : k - buf->gap;
+    if (n == 0) return;
+
+    int from = k < buf->gap ? k : buf->gap + len;
+    int to = k < buf->gap ? k + len : buf->gap;
+    int update = len > 0 && n * 32 < buf->block_cap;
+
+    for (int i = 0; update && i < n; i++) {
+        tree_add_slot(buf, from + i, -buf->blocks[from + i]->count);
+    }
+    memmove(&buf->blocks[to], &buf->blocks[from], n * sizeof(LineBlock *));
+    buf->gap = k;
+    for (int i = 0; update && i < n; i++) {
+        tree_add_slot(buf, to + i, buf->blocks[to + i]->count);
+    }
+    if (!update) tree_rebuild(buf);
+}
+
+// Put blk into the gap, as block `gap`.
+static void gap_put(Buffer *buf, LineBlock *blk) {
+    buf->blocks[buf->gap] = blk;
+    tree_add_slot(buf, buf->gap, blk->count);
+    buf->gap++;
+    buf->block_count++;
+}
+
+// Replace block `at` with n new blocks (n may be 0).
+static void blocks_replace(Buffer *buf, int at, LineBlock **parts, int n) {
+    blocks_reserve(buf, buf->block_count + n);
+    gap_move(buf, at + 1);
+
+    LineBlock *old = buf->blocks[--buf->gap];
+    tree_add_slot(buf, buf->gap, -old->count);
+    buf->block_count--;
+    free(old);
+
+    for (int i = 0; i < n; i++) gap_put(buf, parts[i]);
+}
+
+static void blocks_insert(Buffer *buf, int at, LineBlock *blk) {
+    blocks_reserve(buf, buf->block_count + 1);
+    gap_move(buf, at);
+    gap_put(buf, blk);
+}
+
+static void blocks_remove(Buffer *buf, int at) {
+    blocks_replace(buf, at, NULL, 0);
+}
+
+static LineBlock *block_new(int mapped) {
+    size_t size = sizeof(LineBlock);
+    if (!mapped) size += BLOCK_LINES * sizeof(Line);
+
+    LineBlock *blk = (LineBlock *)malloc(size);
+    blk->count = 0;
+    blk->mapped = mapped;
+    blk->first = 0;
+    blk->syntax = -1;
+    return blk;
+}
+
+static LineBlock *block_new_mapped(int first, int count) {
+    LineBlock *blk = block_new(1);
+    blk->first = first;
+    blk->count = count;
+    return blk;
+}
+
+// Merge a small block with its successor so deletes do not leave a
+// long tail of nearly empty blocks behind.
+static void block_maybe_merge(Buffer *buf, int b) {
+    if (b + 1 >= buf->block_count) return;
+    LineBlock *blk = buffer_block(buf, b);
+    LineBlock *next = buffer_block(buf, b + 1);
+    if (blk->mapped || next->mapped) return;
+    if (blk->count + next->count > BLOCK_LINES / 2) return;
+
+    memcpy(&blk->lines[blk->count], next->lines, next->count * sizeof(Line));
+    tree_add(buf, b, next->count);
+    tree_add(buf, b + 1, -next->count);
+    blk->count += next->count;
+    next->count = 0;
+    blocks_remove(buf, b + 1);
+}
+
+// LINE RECORDS
+// The text of edited lines comes from the buffer's arena.
+static Line line_make(Buffer *buf, const char *text, int len) {
+    Line line;
+    line.text = NULL;
+    line.cap = 0;
+    if (len > 0) {
+        line.text = (char *)arena_alloc(&buf->arena, len, &line.cap);
+        memcpy(line.text, text, len);
+    }
+    line.len = len;
+    return line;
+}
+
+static void line_release(Buffer *buf, Line *line) {
+    if (line->cap > 0) arena_free(&buf->arena, line->text, line->cap);
+}
+
+// Make sure the line owns at least `need` bytes of storage. Lines that
+// still point into the file image are copied out on their first edit.
+// Owned storage grows by half again each time, so typing at the end of
+// a long line copies it a bounded number of times rather than on every
+// key.
+static void line_reserve(Buffer *buf, Line *line, int need) {
+    if (line->cap > 0 && line->cap >= need) return;
+
+    int cap = line->cap + line->cap / 2;
+    if (cap < need) cap = need;
+
+    if (line->cap > 0) {
+        line->text = (char *)arena_grow(&buf->arena, line->text, line->len,
+                                        line->cap, cap, &line->cap);
+    } else {
+        char *text = (char *)arena_alloc(&buf->arena, cap, &line->cap);
+        if (line->len > 0) memcpy(text, line->text, line->len);
+        line->text = text;
+    }
+}
+
+static Line mapped_line(Buffer *buf, int index_line) {
+    size_t start, end;
+    lineindex_span(buf->index, index_line, &start, &end);
+
+    Line line;
+    line.text = buf->data + start;
+    line.len = (int)(end - start);
+    line.cap = 0;
+    return line;
+}
+
+// Turn the lines around `*off` of mapped block b into line records.
+// Returns the owned block now holding that line and updates *off.
+static int materialize(Buffer *buf, int b, int *off) {
+    LineBlock *blk = buffer_block(buf, b);
+    int start = *off - *off % MATERIALIZE_LINES;
+    int end = start + MATERIALIZE_LINES;
+    if (end > blk->count) end = blk->count;
+
+    LineBlock *owned = block_new(0);
+    for (int i = start; i < end; i++) {
+        owned->lines[owned->count++] = mapped_line(buf, blk->first + i);
+    }
+
+    LineBlock *parts[3];
+    int n = 0;
+    if (start > 0) parts[n++] = block_new_mapped(blk->first, start);
+    int at = n;
+    parts[n++] = owned;
+    parts[0]->syntax = blk->syntax;
+    if (end < blk->count) {
+        parts[n++] = block_new_mapped(blk->first + end, blk->count - end);
+    }
+
+    blocks_replace(buf, b, parts, n);
+    *off -= start;
+    return b + at;
+}
+
+// Split mapped block b so that line `off` starts a block of its own.
+static void split_mapped(Buffer *buf, int b, int off) {
+    LineBlock *blk = buffer_block(buf, b);
+    LineBlock *parts[2];
+    parts[0] = block_new_mapped(blk->first, off);
+    parts[1] = block_new_mapped(blk->first + off, blk->count - off);
+    parts[0]->syntax = blk->syntax;
+    blocks_replace(buf, b, parts, 2);
+}
+
+// Record of line y, materialized if it still lives in a mapped block.
+static Line *line_record(Buffer *buf, int y) {
+    int off;
+    int b = buffer_locate(buf, y, &off);
+    if (buffer_block(buf, b)->mapped) b = materialize(buf, b, &off);
+    return &buffer_block(buf, b)->lines[off];
+}
+
+// Owned block and offset where a new line y can be inserted.
+static int insert_position(Buffer *buf, int y, int *off) {
+    int b = buffer_locate(buf, y, off);
+    if (!buffer_block(buf, b)->mapped) return b;
+
+    if (*off == 0 && b > 0 && !buffer_block(buf, b - 1)->mapped) {
+        *off = buffer_block(buf, b - 1)->count;
+        return b - 1;
+    }
+    if (*off == buffer_block(buf, b)->count) {
+        blocks_insert(buf, b + 1, block_new(0));
+        *off = 0;
+        return b + 1;
+    }
+    return materialize(buf, b, off);
+}
+
+static void insert_record(Buffer *buf, int y, Line line) {
+    int off;
+    int b = insert_position(buf, y, &off);
+    LineBlock *blk = buffer_block(buf, b);
+
+    if (blk->count == BLOCK_LINES) {
+        LineBlock *upper = block_new(0);
+        int half = BLOCK_LINES / 2;
+        upper->count = BLOCK_LINES - half;
+        memcpy(upper->lines, &blk->lines[half], upper->count * sizeof(Line));
+        blk->count = half;
+        tree_add(buf, b, -upper->count);
+        blocks_insert(buf, b + 1, upper);
+        if (off > half) {
+            b++;
+            off -= half;
+            blk = upper;
+        }
+    }
+
+    memmove(&blk->lines[off + 1], &blk->lines[off],
+            (blk->count - off) * sizeof(Line));
+    blk->lines[off] = line;
+    blk->count++;
+    buf->line_count++;
+    tree_add(buf, b, 1);
+}
+
+// Insert n records before line y. Short runs go through insert_record();
+// long ones are packed into fresh blocks put into the gap.
+static void insert_records(Buffer *buf, int y, Line *lines, int n) {
+    if (n < BLOCK_LINES / 2) {
+        for (int i = 0; i < n; i++) insert_record(buf, y + i, lines[i]);
+        return;
+    }
+
+    int off;
+    int b = buffer_locate(buf, y, &off);
+    LineBlock *blk = buffer_block(buf, b);
+    int at = b;
+
+    if (off == blk->count) {
+        at = b + 1;
+    } else if (off > 0) {
+        if (blk->mapped) {
+            split_mapped(buf, b, off);
+        } else {
+            LineBlock *upper = block_new(0);
+            upper->count = blk->count - off;
+            memcpy(upper->lines, &blk->lines[off], upper->count * sizeof(Line));
+            blk->count = off;
+            tree_add(buf, b, -upper->count);
+            blocks_insert(buf, b + 1, upper);
+        }
+        at = b + 1;
+    }
+
+    int nblocks = (n + BLOCK_LINES - 1) / BLOCK_LINES;
+    blocks_reserve(buf, buf->block_count + nblocks);
+    gap_move(buf, at);
+
+    for (int k = 0; k < nblocks; k++) {
+        LineBlock *fresh = block_new(0);
+        fresh->count = n - k * BLOCK_LINES;
+        if (fresh->count > BLOCK_LINES) fresh->count = BLOCK_LINES;
+        memcpy(fresh->lines, &lines[k * BLOCK_LINES],
+               fresh->count * sizeof(Line));
+        gap_put(buf, fresh);
+    }
+    buf->line_count += n;
+}
+
+static void remove_record(Buffer *buf, int y) {
+    line_record(buf, y);
+
+    int off;
+    int b = buffer_locate(buf, y, &off);
+    LineBlock *blk = buffer_block(buf, b);
+
+    line_release(buf, &blk->lines[off]);
+    memmove(&blk->lines[off], &blk->lines[off + 1],
+            (blk->count - off - 1) * sizeof(Line));
+    blk->count--;
+    if (off == 0) blk->syntax = -1;
+    buf->line_count--;
+    tree_add(buf, b, -1);
+
+    if (blk->count == 0 && buf->block_count > 1) {
+        blocks_remove(buf, b);
+    } else {
+        if (blk->count < BLOCK_LINES / 4) block_maybe_merge(buf, b);
+    }
+}
+
+// Append without maintaining the tree; callers rebuild it afterwards.
+static void append_record(Buffer *buf, Line line) {
+    gap_move(buf, buf->block_count);
+    LineBlock *blk = buffer_block(buf, buf->block_count - 1);
+    if (blk->mapped || blk->count == BLOCK_LINES) {
+        blocks_reserve(buf, buf->block_count + 1);
+        blk = block_new(0);
+        gap_put(buf, blk);
+    }
+    blk->lines[blk->count++] = line;
+    buf->line_count++;
+}
+
+// INITIALIZATION & CLEANUP
+static void buffer_init_empty(Buffer *buf) {
+    memset(buf, 0, sizeof(Buffer));
+    blocks_reserve(buf, 1);
+    gap_put(buf, block_new(0));
+    buf->changed_from = INT_MAX;
+    buf->changed_to = -1;
+}
+
+void buffer_init(Buffer *buf) {
+    buffer_init_empty(buf);
+    append_record(buf, line_make(buf, "", 0));
+    tree_rebuild(buf);
+}
+
+static void image_unmap(char *data, size_t unmap) {
+    if (unmap) munmap(data, unmap);
+    else free(data);
+}
+
+void buffer_free(Buffer *buf) {
+    lineindex_free(buf->index);
+
+    // Line text lives in the arena and is released with it.
+    for (int b = 0; b < buf->block_count; b++) free(buffer_block(buf, b));
+    free(buf->blocks);
+    free(buf->tree);
+    arena_release(&buf->arena);
+
+    if (buf->reserved) close(buf->data_fd);
+    if (buf->image) {
+        buffer_release_image(buf->image);
+    } else if (buf->data) {
+        image_unmap(buf->data, buf->reserved ? buf->reserved :
+                               buf->data_mapped ? buf->data_size : 0);
+    }
+
+    memset(buf, 0, sizeof(Buffer));
+}
+
+// IMAGE HOLDS
+// The buffer's image is freed by whoever lets go of it last.
+BufferImage *buffer_hold_image(Buffer *buf) {
+    if (!buf->data) return NULL;
+    if (!buf->image) {
+        buf->image = (BufferImage *)malloc(sizeof(BufferImage));
+        buf->image->data = buf->data;
+        buf->image->unmap = buf->reserved ? buf->reserved :
+                            buf->data_mapped ? buf->data_size : 0;
+        buf->image->refs = 1;
+    }
+    buf->image->refs++;
+    return buf->image;
+}
+
+void buffer_release_image(BufferImage *image) {
+    if (!image || --image->refs > 0) return;
+    image_unmap(image->data, image->unmap);
+    free(image);
+}
+
+// Read a whole file descriptor into a heap image.
+static char *read_all(int fd, size_t hint, size_t *size) {
+    size_t cap = hint > 0 ? hint : 65536;
+    size_t len = 0;
+    char *data = (char *)malloc(cap);
+
+    for (;;) {
+        if (len == cap) {
+            cap *= 2;
+            data = (char *)realloc(data, cap);
+        }
+        ssize_t n = read(fd, data + len, cap - len);
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0) {
+            free(data);
+            return NULL;
+        }
+        if (n == 0) break;
+        len += n;
+    }
+    *size = len;
+    return data;
+}
+
+// Index a new buffer's image and take in the first lines.
+static void image_index(Buffer *buf, int background) {
+    buf->index = lineindex_create(buf->data, buf->data_size, background);
+    buf->crlf = buf->index->crlf;
+
+    buffer_sync(buf);
+    if (buf->line_count == 0) {
+        append_record(buf, line_make(buf, "", 0));
+        tree_rebuild(buf);
+    }
+}
+
+// Open a file into a new buffer. Large files are mmap'd and indexed in
+// the background; the buffer fills up as buffer_sync() is called.
+int buffer_open(Buffer *buf, const char *path) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return -1;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        return -1;
+    }
+
+    char *data = NULL;
+    size_t size = 0;
+    int mapped = 0;
+
+    if (S_ISREG(st.st_mode) && st.st_size >= MAP_THRESHOLD) {
+        size = st.st_size;
+        data = (char *)mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data == MAP_FAILED) data = NULL;
+        else mapped = 1;
+    }
+    if (!data) {
+        data = read_all(fd, S_ISREG(st.st_mode) ? st.st_size : 0, &size);
+        if (!data) {
+            close(fd);
+            return -1;
+        }
+    }
+    close(fd);
+
+    buffer_init_empty(buf);
+    buf->data = data;
+    buf->data_size = size;
+    buf->data_mapped = mapped;
+    image_index(buf, mapped);
+    return 0;
+}
+
+// Add lines the indexer has published since the last call.
+// Returns 1 if the buffer grew.
+int buffer_sync(Buffer *buf) {
+    if (!buf->index) return 0;
+
+    int count = lineindex_count(buf->index);
+    int added = count - buf->indexed;
+    if (added <= 0) return 0;
+
+    // Mapped blocks are cut at BLOCK_LINES like owned ones, so whatever
+    // is kept per block (the syntax cache) has the same granularity.
+    int next = buf->indexed;
+    gap_move(buf, buf->block_count);
+    LineBlock *last = buffer_block(buf, buf->block_count - 1);
+    if (last->mapped && last->first + last->count == next &&
+        last->count < BLOCK_LINES) {
+        int n = BLOCK_LINES - last->count;
+        if (n > added) n = added;
+        last->count += n;
+        next += n;
+    }
+    if (buf->line_count == 0) {
+        free(last);
+        buf->block_count = 0;
+        buf->gap = 0;
+    }
+
+    blocks_reserve(buf, buf->block_count +
+                        (count - next + BLOCK_LINES - 1) / BLOCK_LINES);
+    while (next < count) {
+        int n = count - next < BLOCK_LINES ? count - next : BLOCK_LINES;
+        buf->blocks[buf->gap++] = block_new_mapped(next, n);
+        buf->block_count++;
+        next += n;
+    }
+
+    buf->line_count += added;
+    buf->indexed = count;
+    tree_rebuild(buf);
+    return 1;
+}
+
+// 1 while the background indexer is still adding lines.
+int buffer_loading(Buffer *buf) {
+    return buf->index && (buf->indexed < lineindex_count(buf->index) ||
+                          !lineindex_done(buf->index));
+}
+
+// Wait for the indexer and take in every remaining line.
+void buffer_finish(Buffer *buf) {
+    if (!buf->index) return;
+    lineindex_wait(buf->index);
+    buffer_sync(buf);
+}
+
+// Give the pages of a mapped file image back to the kernel; lines still
+// viewed through it are read from the file again when next used. Done
+// for buffers in the background. Returns 0 while the indexer is still
+// reading the image, as it would only bring the pages back.
+int buffer_trim(Buffer *buf) {
+    if (!buf->data_mapped || buf->data_private) return 1;
+    if (buf->index && !lineindex_done(buf->index)) return 0;
+    madvise(buf->data, buf->data_size, MADV_DONTNEED);
+    return 1;
+}
+
+static void note_change(Buffer *buf, int y, int end_y, int delta);
+
+// GROWING IMAGES
+// The image is a copy in anonymous memory rather than a mapping of the
+// file: a mapping would fault on lines past the end of a file that was
+// truncated under it, as logs are when they are rotated.
+static size_t page_round(size_t n) {
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    return (n + page - 1) / page * page;
+}
+
+// Read bytes from..to of the file into the image.
+static int image_fill(Buffer *buf, size_t from, size_t to) {
+    size_t have = page_round(from);
+    size_t need = page_round(to);
+    if (need > have && mprotect(buf->data + have, need - have,
+                                PROT_READ | PROT_WRITE) != 0) {
+        return -1;
+    }
+
+    while (from < to) {
+        ssize_t n = pread(buf->data_fd, buf->data + from, to - from, from);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return -1;
+        from += n;
+    }
+    return 0;
+}
+
+// Open a file that is still being written; buffer_grow() takes in what
+// is appended to it later.
+int buffer_open_growing(Buffer *buf, const char *path) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return -1;
+
+    struct stat st;
+    char *data = (char *)MAP_FAILED;
+    if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) &&
+        (size_t)st.st_size < GROW_RESERVE) {
+        data = (char *)mmap(NULL, GROW_RESERVE, PROT_NONE,
+                            MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE,
+                            -1, 0);
+    }
+    if (data == MAP_FAILED) {
+        close(fd);
+        return -1;
+    }
+
+    buffer_init_empty(buf);
+    buf->data = data;
+    buf->reserved = GROW_RESERVE;
+    buf->data_fd = fd;
+    if (image_fill(buf, 0, st.st_size) != 0) {
+        buffer_free(buf);
+        return -1;
+    }
+    buf->data_size = st.st_size;
+    buf->file_size = st.st_size;
+    image_index(buf, buf->data_size >= MAP_THRESHOLD);
+    return 0;
+}
+
+// 1 if the file ends with the bytes the image ends with, so what was
+// appended continues the text already taken in.
+static int image_tail_matches(Buffer *buf) {
+    char tail[64];
+    size_t n = buf->data_size < sizeof(tail) ? buf->data_size : sizeof(tail);
+    size_t at = buf->data_size - n;
+    return n == 0 || (pread(buf->data_fd, tail, n, at) == (ssize_t)n &&
+                      memcmp(tail, buf->data + at, n) == 0);
+}
+
+// The image's last line got longer. The buffer shows it longer too if it
+// still has it from the image, in a mapped block or in a record made of
+// it and left unedited; an edited one is kept as the user made it.
+static void grow_last_line(Buffer *buf) {
+    int line = buf->indexed - 1;
+    int y = buffer_image_line(buf, line);
+    int off;
+    LineBlock *blk = buffer_block(buf, buffer_locate(buf, y, &off));
+    if (blk->mapped) {
+        if (blk->first + off != line) return;
+    } else {
+        size_t start, end;
+        lineindex_span(buf->index, line, &start, &end);
+        Line *rec = &blk->lines[off];
+        if (rec->cap > 0 || rec->text != buf->data + start) return;
+        rec->len = (int)(end - start);
+    }
+    note_change(buf, y, y, 0);
+}
+
+// Take in up to `budget` bytes appended to a growing image's file.
+// Returns 1 if lines were added or the last one got longer, 0 if there
+// was nothing to take in (yet: not while the image is still being
+// indexed), and -1 if the file was truncated or rewritten and has to be
+// opened again.
+int buffer_grow(Buffer *buf, size_t budget) {
+    if (!buf->reserved || buffer_loading(buf)) return 0;
+
+    struct stat st;
+    if (fstat(buf->data_fd, &st) != 0) return -1;
+    size_t size = st.st_size;
+    buf->file_size = size;
+    if (size < buf->data_size || size > buf->reserved) return -1;
+    if (size == buf->data_size) return 0;
+    if (!image_tail_matches(buf)) return -1;
+
+    if (size - buf->data_size > budget) size = buf->data_size + budget;
+    if (image_fill(buf, buf->data_size, size) != 0) return -1;
+    buf->data_size = size;
+
+    lineindex_wait(buf->index);
+    if (lineindex_extend(buf->index, size)) {
+        if (buf->indexed > 0) grow_last_line(buf);
+        buf->version++;
+    }
+    buf->crlf = buf->index->crlf;
+
+    // The empty line an empty file is shown with gives way to its text.
+    if (buf->indexed == 0 && buf->line_count == 1 &&
+        buffer_line(buf, 0).len == 0) {
+        buffer_block(buf, 0)->count = 0;
+        buf->line_count = 0;
+    }
+    buffer_sync(buf);
+    return 1;
+}
+
+// 1 while the file has more appended bytes than buffer_grow() took in.
+int buffer_growing(Buffer *buf) {
+    return buf->reserved && buf->file_size > buf->data_size;
+}
+
+// ACCESS
+Line buffer_line(Buffer *buf, int y) {
+    int off;
+    int b = buffer_locate(buf, y, &off);
+    LineBlock *blk = buffer_block(buf, b);
+    if (blk->mapped) return mapped_line(buf, blk->first + off);
+    return blk->lines[off];
+}
+
+// First line of block k.
+static int block_start(Buffer *buf, int k) {
+    int y = 0;
+    for (int i = slot(buf, k); i > 0; i -= i & -i) y += buf->tree[i];
+    return y;
+}
+
+// Where line `line` of the file image is in the buffer now. Exact while
+// its block is unedited; otherwise counted on from the last unedited
+// line before it, without passing the next one. Mapped blocks keep
+// their file order, so they are found by binary search, stepping over
+// any edited blocks in between.
+int buffer_image_line(Buffer *buf, int line) {
+    int lo = 0;
+    int hi = buf->block_count;
+    int found = -1;
+    while (lo < hi) {
+        int k = lo + (hi - lo) / 2;
+        int mid = k;
+        while (k < hi && !buffer_block(buf, k)->mapped) k++;
+        if (k < hi && buffer_block(buf, k)->first <= line) {
+            found = k;
+            lo = k + 1;
+        } else {
+            hi = mid;
+        }
+    }
+
+    int y = line;
+    if (found >= 0) {
+        y = block_start(buf, found) + line - buffer_block(buf, found)->first;
+    }
+    int next = found + 1;
+    while (next < buf->block_count && !buffer_block(buf, next)->mapped) {
+        next++;
+    }
+    if (next < buf->block_count && y >= block_start(buf, next)) {
+        y = block_start(buf, next) - 1;
+    }
+    if (y >= buf->line_count) y = buf->line_count - 1;
+    return y < 0 ? 0 : y;
+}
+
+// Walk lines from y onwards without a tree lookup per line.
+void buffer_iter_init(BufferIter *it, Buffer *buf, int y) {
+    it->buf = buf;
+    it->block = buffer_locate(buf, y, &it->off);
+}
+
+Line buffer_iter_next(BufferIter *it) {
+    Buffer *buf = it->buf;
+    LineBlock *blk = buffer_block(buf, it->block);
+    while (it->off >= blk->count && it->block + 1 < buf->block_count) {
+        blk = buffer_block(buf, ++it->block);
+        it->off = 0;
+    }
+
+    int off = it->off++;
+    if (blk->mapped) return mapped_line(buf, blk->first + off);
+    return blk->lines[off];
+}
+
+// Skip up to max whole lines that are still as they are in the file
+// image; *start..*end is their text, with the line break after each.
+// Returns how many, 0 if the next line was edited or the image has
+// "\r\n" breaks.
+int buffer_iter_span(BufferIter *it, int max, size_t *start, size_t *end) {
+    Buffer *buf = it->buf;
+    LineBlock *blk = buffer_block(buf, it->block);
+    while (it->off >= blk->count && it->block + 1 < buf->block_count) {
+        blk = buffer_block(buf, ++it->block);
+        it->off = 0;
+    }
+    if (!blk->mapped || buf->crlf || max <= 0) return 0;
+
+    int n = blk->count - it->off < max ? blk->count - it->off : max;
+    size_t from;
+    lineindex_span(buf->index, blk->first + it->off, start, end);
+    lineindex_span(buf->index, blk->first + it->off + n - 1, &from, end);
+    if (*end >= buf->data_size) return 0;   // The last line has no break
+
+    (*end)++;
+    it->off += n;
+    return n;
+}
+
+// Copy the text between (y1, x1) and (y2, x2) into a new NUL-terminated
+// string, with '\n' between lines.
+char *buffer_copy_range(Buffer *buf, int y1, int x1, int y2, int x2,
+                        size_t *len) {
+    BufferIter it;
+    size_t total = 0;
+
+    buffer_iter_init(&it, buf, y1);
+    for (int y = y1; y <= y2; y++) {
+        Line line = buffer_iter_next(&it);
+        int start = (y == y1) ? (x1 < line.len ? x1 : line.len) : 0;
+        int end = (y == y2) ? (x2 < line.len ? x2 : line.len) : line.len;
+        total += end - start + (y < y2);
+    }
+
+    char *text = (char *)malloc(total + 1);
+    char *p = text;
+
+    buffer_iter_init(&it, buf, y1);
+    for (int y = y1; y <= y2; y++) {
+        Line line = buffer_iter_next(&it);
+        int start = (y == y1) ? (x1 < line.len ? x1 : line.len) : 0;
+        int end = (y == y2) ? (x2 < line.len ? x2 : line.len) : line.len;
+        if (end > start) memcpy(p, line.text + start, end - start);
+        p += end - start;
+        if (y < y2) *p++ = '\n';
+    }
+    *p = '\0';
+
+    *len = total;
+    return text;
+}
+
+// EDIT OPS
+void buffer_insert_text(Buffer *buf, int y, int x, const char *text, int len) {
+    Line *line = line_record(buf, y);
+    if (x > line->len) x = line->len;
+
+    line_reserve(buf, line, line->len + len);
+    memmove(line->text + x + len, line->text + x, line->len - x);
+    if (len > 0) memcpy(line->text + x, text, len);
+    line->len += len;
+}
+
+void buffer_delete_text(Buffer *buf, int y, int x, int len) {
+    Line *line = line_record(buf, y);
+    if (x >= line->len) return;
+    if (len > line->len - x) len = line->len - x;
+
+    line_reserve(buf, line, line->len);
+    memmove(line->text + x, line->text + x + len, line->len - x - len);
+    line->len -= len;
+}
+
+void buffer_split_line(Buffer *buf, int y, int x) {
+    Line *line = line_record(buf, y);
+    if (x > line->len) x = line->len;
+
+    // A line still in the file image splits into two views of it.
+    Line tail;
+    if (line->cap == 0) {
+        tail.text = line->text + x;
+        tail.len = line->len - x;
+        tail.cap = 0;
+    } else {
+        tail = line_make(buf, line->text + x, line->len - x);
+    }
+    line->len = x;
+
+    insert_record(buf, y + 1, tail);
+}
+
+// Append line y + 1 to line y and remove it.
+void buffer_join_lines(Buffer *buf, int y) {
+    if (y + 1 >= buf->line_count) return;
+
+    Line next = buffer_line(buf, y + 1);
+    Line *line = line_record(buf, y);
+    buffer_insert_text(buf, y, line->len, next.text, next.len);
+    remove_record(buf, y + 1);
+}
+
+void buffer_insert_line(Buffer *buf, int y, const char *text, int len) {
+    insert_record(buf, y, line_make(buf, text, len));
+}
+
+// Widen the range of lines changed since the syntax cache caught up:
+// lines y..end_y changed and the ones after moved by delta.
+static void note_change(Buffer *buf, int y, int end_y, int delta) {
+    if (buf->changed_to > y) buf->changed_to += delta;
+    if (end_y > buf->changed_to) buf->changed_to = end_y;
+    if (y < buf->changed_from) buf->changed_from = y;
+}
+
+// Insert text that may contain newlines at (y, x). The text is split
+// into lines once and the new lines are spliced in together, so the cost
+// is linear in the text plus the lines it lands between. The position
+// just past the inserted text is stored in *end_y / *end_x.
+void buffer_insert(Buffer *buf, int y, int x, const char *text, size_t len,
+                   int *end_y, int *end_x) {
+    if (buf->journal) journal_insert(buf->journal, y, x, text, len);
+    buf->version++;
+
+    const char *nl = memchr(text, '\n', len);
+    if (!nl) {
+        Line *line = line_record(buf, y);
+        if (x > line->len) x = line->len;
+        buffer_insert_text(buf, y, x, text, (int)len);
+        *end_y = y;
+        *end_x = x + (int)len;
+        note_change(buf, y, y, 0);
+        return;
+    }
+
+    int count = 0;
+    for (const char *p = nl; p; p = memchr(p + 1, '\n', text + len - p - 1)) {
+        count++;
+    }
+
+    // Cut the tail of line y off; it ends up after the last new line.
+    Line *line = line_record(buf, y);
+    if (x > line->len) x = line->len;
+    Line tail = line_make(buf, line->text + x, line->len - x);
+    line->len = x;
+    buffer_insert_text(buf, y, x, text, (int)(nl - text));
+
+    Line *lines = (Line *)malloc(count * sizeof(Line));
+    const char *p = nl + 1;
+    for (int i = 0; i < count; i++) {
+        const char *end = (i < count - 1) ?
+            memchr(p, '\n', text + len - p) : text + len;
+        lines[i] = line_make(buf, p, (int)(end - p));
+        p = end + 1;
+    }
+
+    Line *last = &lines[count - 1];
+    *end_y = y + count;
+    *end_x = last->len;
+    line_reserve(buf, last, last->len + tail.len);
+    if (tail.len > 0) memcpy(last->text + last->len, tail.text, tail.len);
+    last->len += tail.len;
+    line_release(buf, &tail);
+
+    insert_records(buf, y + 1, lines, count);
+    free(lines);
+    note_change(buf, y, y + count, count);
+}
+
+// Delete the text between (y1, x1) and (y2, x2), joining the two ends.
+void buffer_delete_range(Buffer *buf, int y1, int x1, int y2, int x2) {
+    if (buf->journal) journal_delete(buf->journal, y1, x1, y2, x2);
+    buf->version++;
+    note_change(buf, y1, y1, y1 - y2);
+
+    if (y1 == y2) {
+        buffer_delete_text(buf, y1, x1, x2 - x1);
+        return;
+    }
+
+    Line last = buffer_line(buf, y2);
+    if (x2 > last.len) x2 = last.len;
+    Line tail = line_make(buf, last.text + x2, last.len - x2);
+
+    buffer_delete_lines(buf, y1 + 1, y2 - y1);
+
+    Line *line = line_record(buf, y1);
+    if (x1 > line->len) x1 = line->len;
+    line->len = x1;
+    buffer_insert_text(buf, y1, x1, tail.text, tail.len);
+    line_release(buf, &tail);
+}
+
+// Remove count lines starting at y. Blocks emptied by it are dropped
+// next to the gap; the buffer always keeps at least one line.
+void buffer_delete_lines(Buffer *buf, int y, int count) {
+    if (y < 0 || y >= buf->line_count || count <= 0) return;
+    if (count > buf->line_count - y) count = buf->line_count - y;
+
+    int off;
+    int first = buffer_locate(buf, y, &off);
+    if (buffer_block(buf, first)->mapped && off > 0) {
+        split_mapped(buf, first, off);
+        first++;
+        off = 0;
+    }
+
+    int last = first;
+    int remaining = count;
+
+    for (int b = first; remaining > 0; b++) {
+        LineBlock *blk = buffer_block(buf, b);
+        int start = (b == first) ? off : 0;
+        int n = blk->count - start;
+        if (n > remaining) n = remaining;
+
+        if (blk->mapped) {
+            blk->first += n;  // mapped ranges are always cut at the front
+        } else {
+            for (int i = start; i < start + n; i++) {
+                line_release(buf, &blk->lines[i]);
+            }
+            memmove(&blk->lines[start], &blk->lines[start + n],
+                    (blk->count - start - n) * sizeof(Line));
+        }
+        blk->count -= n;
+        tree_add(buf, b, -n);
+        remaining -= n;
+        if (start == 0) blk->syntax = -1;  // Its first line is gone
+        last = b;
+    }
+    buf->line_count -= count;
+
+    for (int b = last; b >= first; b--) {
+        if (buffer_block(buf, b)->count == 0 && buf->block_count > 1) {
+            blocks_remove(buf, b);
+        }
+    }
+    if (buf->line_count == 0) {
+        append_record(buf, line_make(buf, "", 0));
+        tree_rebuild(buf);
+    }
+}
+
+// SAVING
+// Output is gathered into an iovec list and sent with writev(). Edited
+// lines are copied into a staging buffer; runs of untouched lines are
+// referenced straight from the file image, so a mostly unmodified file
+// is written without copying it.
+typedef struct {
+    int fd;
+    struct iovec iov[SAVE_IOV];
+    int iov_count;
+    char *stage;
+    size_t stage_len;
+    size_t stage_mark;         // Staged bytes not yet in iov
+    size_t written;
+    int failed;
+} SaveWriter;
+
+static void writer_seal(SaveWriter *w) {
+    if (w->stage_len > w->stage_mark) {
+        w->iov[w->iov_count].iov_base = w->stage + w->stage_mark;
+        w->iov[w->iov_count].iov_len = w->stage_len - w->stage_mark;
+        w->iov_count++;
+        w->stage_mark = w->stage_len;
+    }
+}
+
+static void writer_flush(SaveWriter *w) {
+    writer_seal(w);
+
+    struct iovec *iov = w->iov;
+    int n = w->iov_count;
+    while (n > 0 && !w->failed) {
+        ssize_t done = writev(w->fd, iov, n);
+        if (done < 0 && errno == EINTR) continue;
+        if (done < 0) {
+            w->failed = 1;
+            break;
+        }
+        w->written += done;
+        while (n > 0 && (size_t)done >= iov->iov_len) {
+            done -= iov->iov_len;
+            iov++;
+            n--;
+        }
+        if (n > 0) {
+            iov->iov_base = (char *)iov->iov_base + done;
+            iov->iov_len -= done;
+        }
+    }
+    w->iov_count = 0;
+    w->stage_len = 0;
+    w->stage_mark = 0;
+}
+
+// Queue bytes that stay valid until the save ends (the file image).
+static void writer_ref(SaveWriter *w, const char *p, size_t n) {
+    if (n == 0) return;
+    writer_seal(w);
+    w->iov[w->iov_count].iov_base = (void *)p;
+    w->iov[w->iov_count].iov_len = n;
+    w->iov_count++;
+    if (w->iov_count >= SAVE_IOV - 1) writer_flush(w);
+}
+
+static void writer_copy(SaveWriter *w, const char *p, size_t n) {
+    if (n >= SAVE_BUFFER / 4) {
+        writer_ref(w, p, n);
+        return;
+    }
+    if (w->stage_len + n > SAVE_BUFFER) writer_flush(w);
+    memcpy(w->stage + w->stage_len, p, n);
+    w->stage_len += n;
+}
+
+// Write index lines first..first+count-1 as one slice of the image,
+// line endings included. They are written exactly as they were read.
+static void write_mapped(SaveWriter *w, Buffer *buf, int first, int count) {
+    size_t start, end, next;
+    lineindex_span(buf->index, first, &start, &end);
+
+    int last = first + count - 1;
+    if (last + 1 < lineindex_count(buf->index)) {
+        lineindex_span(buf->index, last + 1, &next, &end);
+    } else {
+        next = buf->data_size;
+    }
+    writer_ref(w, buf->data + start, next - start);
+
+    // The file's last line may have no line ending; every saved line does.
+    if (next == buf->data_size && (next == 0 || buf->data[next - 1] != '\n')) {
+        writer_copy(w, buf->crlf ? "\r\n" : "\n", buf->crlf ? 2 : 1);
+    }
+}
+
+static void write_lines(SaveWriter *w, Buffer *buf) {
+    const char *eol = buf->crlf ? "\r\n" : "\n";
+    int eol_len = buf->crlf ? 2 : 1;
+
+    for (int b = 0; b < buf->block_count && !w->failed; b++) {
+        LineBlock *blk = buffer_block(buf, b);
+        if (!blk->mapped) {
+            for (int i = 0; i < blk->count; i++) {
+                writer_copy(w, blk->lines[i].text, blk->lines[i].len);
+                writer_copy(w, eol, eol_len);
+            }
+            continue;
+        }
+
+        // Neighbouring mapped blocks usually continue the same slice.
+        int first = blk->first;
+        int count = blk->count;
+        while (b + 1 < buf->block_count && buffer_block(buf, b + 1)->mapped &&
+               buffer_block(buf, b + 1)->first == first + count) {
+            count += buffer_block(buf, ++b)->count;
+        }
+        write_mapped(w, buf, first, count);
+    }
+    writer_flush(w);
+}
+
+// fsync the directory holding path so a rename into it is durable.
+static void sync_dir(const char *path) {
+    char *dir = strdup(path);
+    char *slash = strrchr(dir, '/');
+    if (!slash) strcpy(dir, ".");
+    else if (slash == dir) slash[1] = '\0';
+    else *slash = '\0';
+
+    int fd = open(dir, O_RDONLY | O_DIRECTORY);
+    if (fd >= 0) {
+        fsync(fd);
+        close(fd);
+    }
+    free(dir);
+}
+
+// Give a mapped image pages of its own, so it no longer changes with the
+// file it was mapped from. Returns -1 if that could not be done.
+static int image_privatize(Buffer *buf) {
+    if (!buf->data_mapped || buf->data_private) return 0;
+    if (mprotect(buf->data, buf->data_size, PROT_READ | PROT_WRITE) != 0) {
+        return -1;
+    }
+    long page = sysconf(_SC_PAGESIZE);
+    for (size_t at = 0; at < buf->data_size; at += page) {
+        volatile char *p = buf->data + at;
+        *p = *p;
+    }
+    mprotect(buf->data, buf->data_size, PROT_READ);
+    buf->data_private = 1;
+    return 0;
+}
+
+// Copy the saved temporary file over a file with other hard links, which
+// a rename would split off from them. The image is taken off the file
+// first, as its unedited lines are still read from there.
+static int copy_in_place(Buffer *buf, int from, const char *target) {
+    if (image_privatize(buf) != 0 || lseek(from, 0, SEEK_SET) != 0) return -1;
+    int fd = open(target, O_WRONLY | O_TRUNC);
+    if (fd < 0) return -1;
+
+    char *chunk = (char *)malloc(SAVE_BUFFER);
+    int failed = !chunk;
+    ssize_t n;
+    while (!failed && (n = read(from, chunk, SAVE_BUFFER)) != 0) {
+        failed = n < 0 || write(fd, chunk, n) != n;
+    }
+    free(chunk);
+    if (close(fd) != 0) failed = 1;
+    return failed ? -1 : 0;
+}
+
+// Save the buffer to path without ever leaving a half-written file
+// behind: the text goes to a temporary file next to it, which is
+// optionally fsync'd and then renamed over the original. The original's
+// permissions, and where allowed its owner, are kept; a file with other
+// hard links is copied over in place instead. Returns 0 and the bytes
+// written, or -1.
+int buffer_save(Buffer *buf, const char *path, int sync, size_t *written) {
+    buffer_finish(buf);
+
+    // Save through a symlink to the file it points at.
+    char *target = realpath(path, NULL);
+    if (!target) target = strdup(path);
+
+    size_t size = strlen(target) + 16;
+    char *tmp_name = (char *)malloc(size);
+    if (!target || !tmp_name) {
+        free(tmp_name);
+        free(target);
+        return -1;
+    }
+    snprintf(tmp_name, size, "%s.liwit~XXXXXX", target);
+
+    int fd = mkstemp(tmp_name);
+    if (fd < 0) {
+        free(tmp_name);
+        free(target);
+        return -1;
+    }
+
+    struct stat st;
+    int links = 1;
+    if (stat(target, &st) == 0) {
+        // Only root can give a file away; others keep the group if they
+        // can, and otherwise own the new file as they would any other.
+        int owned = fchown(fd, st.st_uid, st.st_gid) == 0 ||
+                    fchown(fd, -1, st.st_gid) == 0;
+        (void)owned;
+        fchmod(fd, st.st_mode & 07777);
+        links = st.st_nlink;
+    } else {
+        mode_t mask = umask(0);
+        umask(mask);
+        fchmod(fd, 0666 & ~mask);
+    }
+
+    SaveWriter *w = (SaveWriter *)calloc(1, sizeof(SaveWriter));
+    w->fd = fd;
+    w->stage = (char *)malloc(SAVE_BUFFER);
+    write_lines(w, buf);
+
+    int failed = w->failed;
+    *written = w->written;
+    free(w->stage);
+    free(w);
+
+    if (!failed && sync && fsync(fd) != 0) failed = 1;
+    if (!failed && links > 1) {
+        // Should the copy fail half way, the temporary file is all that
+        // is left of the text: it is kept.
+        if (copy_in_place(buf, fd, target) != 0) {
+            close(fd);
+            free(tmp_name);
+            free(target);
+            return -1;
+        }
+        close(fd);
+        unlink(tmp_name);
+        free(tmp_name);
+        free(target);
+        return 0;
+    }
+    if (close(fd) != 0) failed = 1;
+    if (!failed && rename(tmp_name, target) != 0) failed = 1;
+
+    if (failed) unlink(tmp_name);
+    else if (sync) sync_dir(target);
+    free(tmp_name);
+    free(target);
+    return failed ? -1 : 0;
+}
@@ -0,0 +1,157 @@
+/*
+ * LIWIT - Linux-Windows Text Editor
+ * Copyright (C) 2026  Khud Bakhtiyar Iqbal Sofi
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Text buffer.
+ *
+ * Lines are kept in small fixed-size blocks (a "rope" of line blocks).
+ * A Fenwick tree over the block sizes finds the block holding any line
+ * in O(log n), so inserting or deleting a line only shifts the lines of
+ * one block instead of the whole file. The block array itself keeps a
+ * gap of free slots where blocks were last added or removed, so a block
+ * split next to the cursor does not shift the pointers to all the others
+ * either. There is no limit on the number of lines or on the length of
+ * a line.
+ *
+ * An opened file is kept as one image (mmap'd when large) and described
+ * by "mapped" blocks: ranges of lines of the image's line index with no
+ * per-line storage at all. Only the lines around an edit are turned into
+ * line records, and even those keep pointing into the image until their
+ * text actually changes. Text that does change is stored in the buffer's
+ * arena, which is released in one go when the buffer is freed.
+ *
+ * A file that is still being written can be opened as a growing image
+ * instead: a copy of the file at the start of a large reserved range of
+ * address space. Bytes appended to the file later are read in right
+ * after it, so the lines already viewed through the image stay put and
+ * only the new lines are indexed and added.
+ */
+
+#ifndef LIWIT_BUFFER_H
+#define LIWIT_BUFFER_H
+
+#include <stddef.h>
+#include "lineindex.h"
+#include "journal.h"
+#include "arena.h"
+
+// CONFIGURATION
+#define BLOCK_LINES 256            // Lines per block
+#define MATERIALIZE_LINES 64       // Mapped lines turned into records at once
+#define MAP_THRESHOLD (1 << 20)    // Files this large are mmap'd
+#define SAVE_BUFFER (1 << 20)      // Staging buffer for edited lines
+#define SAVE_IOV 1024              // Pieces gathered per writev()
+#define GROW_RESERVE ((size_t)1 << 40)  // Address space for a growing image
+
+// DATA STRUCTURES
+typedef struct {
+    char *text;                // Line bytes (not NUL-terminated), no '\n'
+    int len;                   // Length in bytes
+    int cap;                   // Allocated size, 0 if text is not owned
+} Line;
+
+typedef struct {
+    int count;                 // Lines in this block
+    int mapped;                // 1 if the lines come from the line index
+    int first;                 // First index line (mapped blocks only)
+    int syntax;                // Lexer state at the first line, -1 if unknown
+    Line lines[];              // Line records (owned blocks only)
+} LineBlock;
+
+// A hold on a file image that can outlive its buffer, so the text of
+// unedited lines can be pointed at instead of copied.
+typedef struct {
+    char *data;
+    size_t unmap;              // Bytes to munmap, 0 if data is malloc'd
+    int refs;                  // Holders, the buffer included while it lives
+} BufferImage;
+
+typedef struct {
+    LineBlock **blocks;        // Blocks in file order, around the gap
+    int block_count;
+    int block_cap;
+    int gap;                   // Blocks before the gap
+    int *tree;                 // Fenwick tree of slot sizes (1-based)
+    int line_count;            // Total number of lines (always >= 1)
+
+    char *data;                // File image, NULL for a new buffer
+    size_t data_size;
+    int data_mapped;           // 1 if data is an mmap, 0 if heap
+    int data_private;          // 1 once the mmap no longer reads the file
+    size_t reserved;           // Address space held for a growing image
+    int data_fd;               // File a growing image is read from
+    size_t file_size;          // Its size when last looked at
+    int crlf;                  // 1 to save with "\r\n" line endings
+    LineIndex *index;          // Line index over data
+    int indexed;               // Index lines already added to the buffer
+    BufferImage *image;        // Shared hold on data, NULL until one is taken
+
+    Arena arena;               // Text of edited lines
+    Journal *journal;          // Told about every change, or NULL
+    unsigned long version;     // Bumped by every change to the text
+    int changed_from;          // Lines changed since the syntax cache last
+    int changed_to;            // caught up (INT_MAX, -1 if none)
+} Buffer;
+
+typedef struct {
+    Buffer *buf;
+    int block;                 // Block of the next line
+    int off;                   // Its offset in that block
+} BufferIter;
+
+// Block k, counting past the gap.
+static inline LineBlock *buffer_block(Buffer *buf, int k) {
+    int gap_len = buf->block_cap - buf->block_count;
+    return buf->blocks[k < buf->gap ? k : k + gap_len];
+}
+
+// PROTOTYPES
+void buffer_init(Buffer *buf);
+void buffer_free(Buffer *buf);
+int buffer_open(Buffer *buf, const char *path);
+int buffer_sync(Buffer *buf);
+int buffer_loading(Buffer *buf);
+void buffer_finish(Buffer *buf);
+int buffer_trim(Buffer *buf);
+int buffer_open_growing(Buffer *buf, const char *path);
+int buffer_grow(Buffer *buf, size_t budget);
+int buffer_growing(Buffer *buf);
+int buffer_save(Buffer *buf, const char *path, int sync, size_t *written);
+BufferImage *buffer_hold_image(Buffer *buf);
+void buffer_release_image(BufferImage *image);
+
+int buffer_locate(Buffer *buf, int y, int *off);
+Line buffer_line(Buffer *buf, int y);
+int buffer_image_line(Buffer *buf, int line);
+void buffer_iter_init(BufferIter *it, Buffer *buf, int y);
+Line buffer_iter_next(BufferIter *it);
+int buffer_iter_span(BufferIter *it, int max, size_t *start, size_t *end);
+char *buffer_copy_range(Buffer *buf, int y1, int x1, int y2, int x2,
+                        size_t *len);
+
+void buffer_insert_text(Buffer *buf, int y, int x, const char *text, int len);
+void buffer_delete_text(Buffer *buf, int y, int x, int len);
+void buffer_split_line(Buffer *buf, int y, int x);
+void buffer_join_lines(Buffer *buf, int y);
+void buffer_insert_line(Buffer *buf, int y, const char *text, int len);
+void buffer_insert(Buffer *buf, int y, int x, const char *text, size_t len,
+                   int *end_y, int *end_x);
+void buffer_delete_lines(Buffer *buf, int y, int count);
+void buffer_delete_range(Buffer *buf, int y1, int x1, int y2, int x2);
+
+#endif
@@ -0,0 +1,132 @@
+/*
+ * LIWIT - Linux-Windows Text Editor
+ * Copyright (C) 2026  Khud Bakhtiyar Iqbal Sofi
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "clipboard.h"
+
+void clipboard_clear(Clipboard *c) {
+    free(c->pieces);
+    free(c->own);
+    free(c->flat);
+    buffer_release_image(c->image);
+    memset(c, 0, sizeof(Clipboard));
+}
+
+// Add a piece, or grow the last one if this one carries on from it.
+static void add_piece(Clipboard *c, int owned, size_t off, size_t len) {
+    c->len += len;
+    c->copied = 1;
+    if (c->count > 0) {
+        ClipPiece *last = &c->pieces[c->count - 1];
+        if (last->owned == owned && last->off + last->len == off) {
+            last->len += len;
+            return;
+        }
+    }
+
+    if (c->count == c->cap) {
+        c->cap = c->cap ? c->cap * 2 : 16;
+        c->pieces = (ClipPiece *)realloc(c->pieces,
+                                         c->cap * sizeof(ClipPiece));
+    }
+    c->pieces[c->count++] = (ClipPiece){owned, off, len};
+}
+
+void clipboard_add_text(Clipboard *c, const char *text, size_t len) {
+    if (c->own_len + len > c->own_cap) {
+        c->own_cap = c->own_cap * 2 > c->own_len + len ?
+                     c->own_cap * 2 : c->own_len + len + 64;
+        c->own = (char *)realloc(c->own, c->own_cap);
+    }
+    memcpy(c->own + c->own_len, text, len);
+    add_piece(c, 1, c->own_len, len);
+    c->own_len += len;
+}
+
+// Bytes x1 of line y1 to x2 of line y2, with the line breaks between,
+// as buffer_copy_range() would return them.
+void clipboard_add_range(Clipboard *c, Buffer *buf, int y1, int x1,
+                         int y2, int x2) {
+    const char *data = buf->data;
+    size_t size = buf->data_size;
+    if (data && !c->image) c->image = buffer_hold_image(buf);
+    if (c->image && c->image->data != data) data = NULL;
+
+    BufferIter it;
+    buffer_iter_init(&it, buf, y1);
+    for (int y = y1; y <= y2; y++) {
+        // Whole lines in between that were never edited lie back to
+        // back in the image, a block of them at a time.
+        size_t from, to;
+        int n = (data && y > y1) ? buffer_iter_span(&it, y2 - y, &from, &to)
+                                 : 0;
+        if (n > 0) {
+            add_piece(c, 0, from, to - from);
+            y += n - 1;
+            continue;
+        }
+
+        Line line = buffer_iter_next(&it);
+        int start = (y == y1) ? (x1 < line.len ? x1 : line.len) : 0;
+        int end = (y == y2) ? (x2 < line.len ? x2 : line.len) : line.len;
+        int mapped = data && line.cap == 0 && line.text >= data &&
+                     line.text + line.len <= data + size;
+
+        if (end > start && mapped) {
+            add_piece(c, 0, line.text + start - data, end - start);
+        } else if (end > start) {
+            clipboard_add_text(c, line.text + start, end - start);
+        }
+        if (y == y2) break;
+
+        if (mapped && line.text + line.len < data + size &&
+            line.text[line.len] == '\n') {
+            add_piece(c, 0, line.text + line.len - data, 1);
+        } else {
+            clipboard_add_text(c, "\n", 1);
+        }
+    }
+    c->copied = 1;
+}
+
+// The whole text in one string. The pieces are let go of after this,
+// and with them the image.
+const char *clipboard_text(Clipboard *c, size_t *len) {
+    if (!c->flat) {
+        c->flat = (char *)malloc(c->len + 1);
+        char *p = c->flat;
+        for (int i = 0; i < c->count; i++) {
+            const char *from = c->pieces[i].owned ? c->own : c->image->data;
+            memcpy(p, from + c->pieces[i].off, c->pieces[i].len);
+            p += c->pieces[i].len;
+        }
+        *p = '\0';
+
+        free(c->pieces);
+        free(c->own);
+        buffer_release_image(c->image);
+        c->pieces = NULL;
+        c->own = NULL;
+        c->image = NULL;
+        c->count = c->cap = 0;
+        c->own_len = c->own_cap = 0;
+    }
+    *len = c->len;
+    return c->flat;
+}
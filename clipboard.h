@@ -0,0 +1,64 @@
+/*
+ * LIWIT - Linux-Windows Text Editor
+ * Copyright (C) 2026  Khud Bakhtiyar Iqbal Sofi
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Clipboard.
+ *
+ * Copied text is kept as pieces rather than copied out: runs of the
+ * file image, which does not change while anyone holds it, and the few
+ * bytes that are not in it (edited lines, line breaks the image spells
+ * differently). Unedited lines lie back to back in the image, so a
+ * million of them are one piece. The text is put together the first
+ * time it is needed in one string, to paste it.
+ */
+
+#ifndef LIWIT_CLIPBOARD_H
+#define LIWIT_CLIPBOARD_H
+
+#include <stddef.h>
+#include "buffer.h"
+
+// DATA STRUCTURES
+typedef struct {
+    int owned;                 // 1 if off is into own, 0 into the image
+    size_t off;
+    size_t len;
+} ClipPiece;
+
+typedef struct {
+    ClipPiece *pieces;
+    int count;
+    int cap;
+    BufferImage *image;        // Image the pieces not owned point into
+    char *own;                 // Copied bytes
+    size_t own_len;
+    size_t own_cap;
+    size_t len;                // Length of the whole text
+    char *flat;                // The whole text, once asked for
+    int copied;                // 1 once anything was copied
+    int block;                 // 1 for a rectangle, one line per row
+} Clipboard;
+
+// PROTOTYPES
+void clipboard_clear(Clipboard *c);
+void clipboard_add_range(Clipboard *c, Buffer *buf, int y1, int x1,
+                         int y2, int x2);
+void clipboard_add_text(Clipboard *c, const char *text, size_t len);
+const char *clipboard_text(Clipboard *c, size_t *len);
+
+#endif
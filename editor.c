@@ -0,0 +1,1773 @@
+/*
+ * LIWIT - Linux-Windows Text Editor
+ * Copyright (C) 2026  Khud Bakhtiyar Iqbal Sofi
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <time.h>
+#include "editor.h"
+
+// GLOBALS
+Clipboard clipboard;           // Shared by every tab and pane
+
+// INITIALIZATION & CLEANUP
+// LIWIT_UNDO_MB overrides the undo history's memory limit.
+size_t undo_budget(void) {
+    const char *undo_mb = getenv("LIWIT_UNDO_MB");
+    return undo_mb ? (size_t)atol(undo_mb) << 20 : UNDO_BUDGET;
+}
+
+// An empty new file in one tab and one pane of rows x cols (menu and
+// status bar included). The front end gives the pane its window.
+void editor_init(EditorState *ed, int rows, int cols) {
+    memset(ed, 0, sizeof(EditorState));
+    buffer_init(&ed->buf);
+    undo_init(&ed->undo, undo_budget());
+    ed->insert_mode = 1;
+    ed->screen_rows = rows;
+    ed->screen_cols = cols;
+    ed->view_rows = rows - 2;
+    ed->view_cols = cols;
+
+    ed->dirty_from = -1;
+    ed->dirty_to = -1;
+    ed->dirty_menu = 1;
+
+    search_init(&ed->search);
+    syntax_init(&ed->syntax);
+    columns_init(&ed->columns);
+
+    ed->tabs = (Tab *)calloc(1, sizeof(Tab));
+    ed->tab_count = 1;
+    ed->panes = (Pane *)calloc(1, sizeof(Pane));
+    ed->pane_count = 1;
+    ed->panes[0].top = 1;
+    ed->panes[0].height = rows - 2;
+    ed->panes[0].width = cols;
+}
+
+// Everything but the front end's windows and what it painted in them.
+void editor_free(EditorState *ed) {
+    if (ed->replacing) {
+        replace_cancel(&ed->replace);
+        replace_free(&ed->replace);
+    }
+    journal_stop(ed->buf.journal, 0);
+    buffer_free(&ed->buf);
+    undo_free(&ed->undo);
+    search_free(&ed->search);
+    syntax_free(&ed->syntax);
+    columns_free(&ed->columns);
+    follow_stop(ed->follow);
+    if (ed->filename) free(ed->filename);
+
+    free(ed->carets);
+    for (int i = 0; i < ed->pane_count; i++) {
+        if (i == ed->pane) continue;
+        free(ed->panes[i].carets);
+    }
+    free(ed->panes);
+    clipboard_clear(&clipboard);
+
+    for (int i = 0; i < ed->tab_count; i++) {
+        if (i != ed->tab) free_tab(&ed->tabs[i]);
+    }
+    free(ed->tabs);
+}
+void free_tab(Tab *t) {
+    journal_stop(t->buf.journal, 0);
+    buffer_free(&t->buf);
+    undo_free(&t->undo);
+    search_free(&t->search);
+    syntax_free(&t->syntax);
+    columns_free(&t->columns);
+    follow_stop(t->follow);
+    if (t->filename) free(t->filename);
+    if (t->pending) free(t->pending);
+}
+
+// REDRAW BOOKKEEPING
+// Queue file lines from..to (inclusive) for repainting.
+void mark_dirty(EditorState *ed, int from, int to) {
+    if (ed->dirty_from < 0 || from < ed->dirty_from) ed->dirty_from = from;
+    if (to > ed->dirty_to) ed->dirty_to = to;
+}
+
+// The text of lines from..to changed: queue them in every pane showing it.
+void mark_changed(EditorState *ed, int from, int to) {
+    mark_dirty(ed, from, to);
+    for (int i = 0; i < ed->pane_count; i++) {
+        Pane *p = &ed->panes[i];
+        if (i == ed->pane || p->tab != ed->tab) continue;
+        if (p->dirty_from < 0 || from < p->dirty_from) p->dirty_from = from;
+        if (to > p->dirty_to) p->dirty_to = to;
+    }
+}
+
+static void refine_jump(EditorState *ed);
+
+// Take in lines the indexer found since the last call. Not while the
+// replace workers walk the blocks: what was appended in the meantime
+// (its inotify events stay queued) is taken in once they are done.
+void sync_buffer(EditorState *ed) {
+    if (ed->replacing) return;
+    if (ed->follow) follow_appended(ed);
+    int old_count = ed->buf.line_count;
+    if (buffer_sync(&ed->buf)) mark_changed(ed, old_count, DIRTY_TO_END);
+    if (ed->jump.kind != JUMP_NONE) refine_jump(ed);
+}
+
+void mark_all_dirty(EditorState *ed) {
+    ed->dirty_all = 1;
+}
+
+// MESSAGES
+long now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000L + ts.tv_nsec / 1000000;
+}
+
+// Queue a status bar message for duration_ms. Returns immediately.
+void show_message(EditorState *ed, const char *msg, int duration_ms) {
+    if (ed->message_count > 0) {
+        int last = (ed->message_head + ed->message_count - 1) % MESSAGE_QUEUE;
+        if (strcmp(ed->messages[last].text, msg) == 0) {
+            if (last == ed->message_head) ed->message_shown = 0;
+            return;
+        }
+    }
+    if (ed->message_count == MESSAGE_QUEUE) {
+        ed->message_head = (ed->message_head + 1) % MESSAGE_QUEUE;
+        ed->message_count--;
+        ed->message_shown = 0;
+    }
+
+    int slot = (ed->message_head + ed->message_count) % MESSAGE_QUEUE;
+    snprintf(ed->messages[slot].text, sizeof(ed->messages[slot].text),
+             "%s", msg);
+    ed->messages[slot].duration_ms = duration_ms;
+    ed->message_count++;
+}
+
+// Time the head message stays up; shorter when others are waiting.
+static int message_duration(EditorState *ed) {
+    int duration = ed->messages[ed->message_head].duration_ms;
+    if (ed->message_count > 1 && duration > MESSAGE_MIN_MS) {
+        duration = MESSAGE_MIN_MS;
+    }
+    return duration;
+}
+
+// The message to show now, dropping the ones that expired.
+Message *current_message(EditorState *ed) {
+    long now = now_ms();
+    while (ed->message_count > 0 && ed->message_shown > 0 &&
+           now >= ed->message_shown + message_duration(ed)) {
+        ed->message_head = (ed->message_head + 1) % MESSAGE_QUEUE;
+        ed->message_count--;
+        ed->message_shown = 0;
+    }
+    if (ed->message_count == 0) return NULL;
+
+    if (ed->message_shown == 0) ed->message_shown = now;
+    return &ed->messages[ed->message_head];
+}
+
+// Milliseconds until the message on screen expires, -1 if there is none.
+int message_timeout(EditorState *ed) {
+    if (ed->message_count == 0 || ed->message_shown == 0) return -1;
+    long left = ed->message_shown + message_duration(ed) - now_ms();
+    return left > 0 ? (int)left : 0;
+}
+
+// FILE OPS
+// Save under ed->filename, which the caller has made sure is set.
+int write_file(EditorState *ed) {
+    struct timespec t0, t1;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+
+    size_t written;
+    if (buffer_save(&ed->buf, ed->filename, SAVE_FSYNC, &written) != 0) {
+        show_message(ed, "ERROR: Cannot save file!", 2000);
+        return -1;
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    double secs = (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) / 1e9;
+    ed->modified = 0;
+    undo_mark_saved(&ed->undo);
+
+    // The saved file is a new one under the old name; following it would
+    // only reopen it.
+    follow_stop(ed->follow);
+    ed->follow = NULL;
+    if (ed->buf.journal) journal_reset(ed->buf.journal, ed->filename);
+    else ed->buf.journal = journal_start(ed->filename);
+
+    char msg[128];
+    if (written < 1000000) {
+        snprintf(msg, sizeof(msg), "Saved %zu bytes", written);
+    } else {
+        snprintf(msg, sizeof(msg), "Saved %.1f MB in %.0f ms (%.0f MB/s)",
+                 written / 1e6, secs * 1000, written / 1e6 / secs);
+    }
+    show_message(ed, msg, 1000);
+    return 0;
+}
+
+// Load a file into the active tab, replacing what it held. A followed
+// file is kept open to take in what is appended to it.
+static int load_file(EditorState *ed, const char *filename, int follow) {
+    Buffer loaded;
+    int failed = follow ? buffer_open_growing(&loaded, filename) :
+                          buffer_open(&loaded, filename);
+    if (failed) {
+        show_message(ed, "ERROR: Cannot open file!", 2000);
+        return -1;
+    }
+
+    follow_stop(ed->follow);
+    ed->follow = follow ? follow_start(filename, loaded.data_fd) : NULL;
+
+    journal_stop(ed->buf.journal, 0);
+    buffer_free(&ed->buf);
+    ed->buf = loaded;
+    undo_clear(&ed->undo);
+    columns_invalidate(&ed->columns, 0, DIRTY_TO_END);
+    search_free(&ed->search);
+
+    if (ed->filename) free(ed->filename);
+    ed->filename = strdup(filename);
+    syntax_select(&ed->syntax, filename, buffer_line(&ed->buf, 0));
+    ed->cursor_x = 0;
+    ed->cursor_y = 0;
+    ed->offset_x = 0;
+    ed->offset_y = 0;
+    ed->modified = 0;
+    ed->selecting = SEL_NONE;
+    ed->jump.kind = JUMP_NONE;
+    ed->caret_count = 0;
+    mark_changed(ed, 0, DIRTY_TO_END);
+    mark_all_dirty(ed);
+    ed->dirty_menu = 1;
+
+    int journal = journal_check(filename);
+    ed->buf.journal = journal_start(filename);
+    if (journal > 0) {
+        recover_journal(ed);
+    } else if (journal < 0) {
+        show_message(ed, "Recovery journal is older than the file; ignored",
+                     2000);
+    }
+    return 0;
+}
+
+int open_file(EditorState *ed, const char *filename) {
+    return load_file(ed, filename, 0);
+}
+
+// liwit -f: show lines appended to the file as they are written.
+int follow_file(EditorState *ed, const char *filename) {
+    return load_file(ed, filename, 1);
+}
+
+// Take in what was appended to the followed file. Panes whose cursor was
+// on the last line move down with it. A file that was truncated or
+// replaced under its name is opened again.
+void follow_appended(EditorState *ed) {
+    int event = follow_poll(ed->follow);
+    if (!event && !buffer_growing(&ed->buf)) return;
+
+    int last = ed->buf.line_count - 1;
+    int at_end = ed->cursor_y == last;
+    int grown = event == FOLLOW_REPLACED ? -1 :
+                buffer_grow(&ed->buf, FOLLOW_READ_BYTES);
+
+    if (grown < 0) {
+        char *filename = strdup(ed->filename);
+        if (follow_file(ed, filename) == 0) {
+            show_message(ed, event == FOLLOW_REPLACED ?
+                         "File was replaced; reopened" :
+                         "File was truncated; reopened", 1500);
+        } else {
+            follow_stop(ed->follow);
+            ed->follow = NULL;
+        }
+        free(filename);
+        if (at_end) ed->cursor_y = ed->buf.line_count - 1;
+        scroll_if_needed(ed);
+        return;
+    }
+    if (grown == 0) return;
+
+    mark_changed(ed, last, DIRTY_TO_END);
+    columns_invalidate(&ed->columns, last, DIRTY_TO_END);
+    int end = ed->buf.line_count - 1;
+    if (end == last) return;
+
+    for (int i = 0; i < ed->pane_count; i++) {
+        Pane *p = &ed->panes[i];
+        if (i == ed->pane || p->tab != ed->tab || p->cursor_y != last) continue;
+        p->cursor_y = end;
+        p->cursor_x = 0;
+        if (p->offset_y < end - p->rows + 1) p->offset_y = end - p->rows + 1;
+    }
+    if (at_end) {
+        ed->cursor_y = end;
+        ed->cursor_x = 0;
+        scroll_if_needed(ed);
+    }
+}
+
+static void replay_change(void *ctx, int type, int y, int x,
+                          int end_y, int end_x,
+                          const char *text, size_t len) {
+    EditorState *ed = (EditorState *)ctx;
+    if (y >= ed->buf.line_count) return;
+
+    if (type == JOURNAL_INSERT) {
+        edit_insert(ed, y, x, text, len);
+    } else if (end_y < ed->buf.line_count) {
+        edit_delete(ed, y, x, end_y, end_x);
+    }
+}
+
+// A journal survived the last session: offer to apply its changes.
+// They go through the normal edit path, so they can be undone and are
+// journaled again straight away.
+void recover_journal(EditorState *ed) {
+    if (!ed->ask || !ed->ask(ed, "Unsaved changes from a previous session "
+                                 "found. Recover?")) {
+        journal_discard(ed->filename);
+        return;
+    }
+
+    buffer_finish(&ed->buf);
+    int count = journal_replay(ed->filename, replay_change, ed);
+    mark_all_dirty(ed);
+    scroll_if_needed(ed);
+
+    char msg[64];
+    snprintf(msg, sizeof(msg), "Recovered %d changes", count);
+    show_message(ed, msg, 1000);
+}
+
+// TABS
+// The editing code works on the file in EditorState. Switching tabs
+// parks it in ed->tabs[ed->tab] and brings the other one in; a tab given
+// on the command line is only opened when it is first shown.
+void store_tab(EditorState *ed, Tab *t) {
+    t->buf = ed->buf;
+    t->undo = ed->undo;
+    t->search = ed->search;
+    t->syntax = ed->syntax;
+    t->columns = ed->columns;
+    t->filename = ed->filename;
+    t->modified = ed->modified;
+    t->follow = ed->follow;
+    t->cursor_x = ed->cursor_x;
+    t->cursor_y = ed->cursor_y;
+    t->offset_x = ed->offset_x;
+    t->offset_y = ed->offset_y;
+    t->selecting = ed->selecting;
+    t->sel_y = ed->sel_y;
+    t->sel_x = ed->sel_x;
+    t->sel_col = ed->sel_col;
+    t->block_col = ed->block_col;
+    t->trimmed = 0;
+}
+
+void load_tab(EditorState *ed, Tab *t) {
+    ed->buf = t->buf;
+    ed->undo = t->undo;
+    ed->search = t->search;
+    ed->syntax = t->syntax;
+    ed->columns = t->columns;
+    ed->filename = t->filename;
+    ed->modified = t->modified;
+    ed->follow = t->follow;
+    ed->cursor_x = t->cursor_x;
+    ed->cursor_y = t->cursor_y;
+    ed->offset_x = t->offset_x;
+    ed->offset_y = t->offset_y;
+    ed->selecting = t->selecting;
+    ed->sel_y = t->sel_y;
+    ed->sel_x = t->sel_x;
+    ed->sel_col = t->sel_col;
+    ed->block_col = t->block_col;
+}
+
+// A tab at position `at` with an empty buffer, to be filled from file
+// `pending` when first shown (NULL for a new file).
+static void insert_tab(EditorState *ed, int at, const char *pending) {
+    ed->tabs = (Tab *)realloc(ed->tabs, (ed->tab_count + 1) * sizeof(Tab));
+    memmove(&ed->tabs[at + 1], &ed->tabs[at],
+            (ed->tab_count - at) * sizeof(Tab));
+    ed->tab_count++;
+    if (at <= ed->tab) ed->tab++;
+    for (int i = 0; i < ed->pane_count; i++) {
+        if (ed->panes[i].tab >= at) ed->panes[i].tab++;
+    }
+
+    Tab *t = &ed->tabs[at];
+    memset(t, 0, sizeof(Tab));
+    buffer_init(&t->buf);
+    undo_init(&t->undo, undo_budget());
+    search_init(&t->search);
+    syntax_init(&t->syntax);
+    columns_init(&t->columns);
+    t->pending = pending ? strdup(pending) : NULL;
+    ed->dirty_menu = 1;
+}
+
+// Show tab n in the active pane.
+static void activate_tab(EditorState *ed, int n) {
+    Tab *t = &ed->tabs[n];
+    ed->tab = n;
+    ed->panes[ed->pane].tab = n;
+    load_tab(ed, t);
+    ed->search_hit = 0;
+    ed->caret_count = 0;
+    ed->jump.kind = JUMP_NONE;
+    mark_all_dirty(ed);
+    ed->dirty_menu = 1;
+
+    if (t->pending) {
+        char *filename = t->pending;
+        t->pending = NULL;
+        if (t->pending_follow) follow_file(ed, filename);
+        else open_file(ed, filename);
+        free(filename);
+    }
+}
+
+// Close the active tab and show tab n (numbered as before the close),
+// also in the other panes that showed the closed one.
+static void remove_tab(EditorState *ed, int n) {
+    int at = ed->tab;
+    store_tab(ed, &ed->tabs[at]);
+    free_tab(&ed->tabs[at]);
+    memmove(&ed->tabs[at], &ed->tabs[at + 1],
+            (ed->tab_count - at - 1) * sizeof(Tab));
+    ed->tab_count--;
+    if (n > at) n--;
+
+    for (int i = 0; i < ed->pane_count; i++) {
+        Pane *p = &ed->panes[i];
+        if (i == ed->pane || p->tab < at) continue;
+        if (p->tab > at) {
+            p->tab--;
+            continue;
+        }
+        p->tab = n;
+        p->cursor_x = p->cursor_y = 0;
+        p->offset_x = p->offset_y = 0;
+        p->selecting = SEL_NONE;
+        p->dirty_all = 1;
+    }
+    activate_tab(ed, n);
+}
+
+void add_tab(EditorState *ed, const char *filename) {
+    insert_tab(ed, ed->tab_count, filename);
+}
+
+// Ctrl+O: show the file in a tab of its own. A file that is already open
+// is switched to, and an untouched new file is replaced.
+void open_tab(EditorState *ed, const char *filename) {
+    for (int i = 0; i < ed->tab_count; i++) {
+        const char *name = tab_filename(ed, i);
+        if (name && strcmp(name, filename) == 0) {
+            switch_tab(ed, i);
+            return;
+        }
+    }
+    if (!ed->filename && !ed->modified) {
+        open_file(ed, filename);
+        return;
+    }
+
+    int prev = ed->tab;
+    insert_tab(ed, ed->tab + 1, NULL);
+    switch_tab(ed, ed->tab + 1);
+    if (open_file(ed, filename) != 0) remove_tab(ed, prev);
+}
+
+void switch_tab(EditorState *ed, int n) {
+    if (n == ed->tab || n < 0 || n >= ed->tab_count) return;
+    store_tab(ed, &ed->tabs[ed->tab]);
+    activate_tab(ed, n);
+}
+
+// File name shown for tab i, NULL for a new file.
+const char *tab_filename(EditorState *ed, int i) {
+    if (i == ed->tab) return ed->filename;
+    return ed->tabs[i].filename ? ed->tabs[i].filename : ed->tabs[i].pending;
+}
+
+// Offer to save the active file before it goes away. Returns 0 if it
+// should stay: the user wanted it saved, but that did not happen.
+int confirm_save(EditorState *ed) {
+    char question[512];
+    snprintf(question, sizeof(question), "Save changes to %s?",
+             ed->filename ? ed->filename : "[New File]");
+    if (ed->ask && ed->ask(ed, question)) {
+        if (ed->save) ed->save(ed);
+        return !ed->modified;
+    }
+    return 1;
+}
+
+// Ctrl+W. Returns 1 if that was the last tab, which closes the editor,
+// and the user let it go.
+int close_tab(EditorState *ed) {
+    if (ed->modified && !confirm_save(ed)) return 0;
+    if (ed->tab_count == 1) return 1;
+    remove_tab(ed, ed->tab + 1 < ed->tab_count ? ed->tab + 1 : ed->tab - 1);
+    return 0;
+}
+
+// EDIT OPS
+// Every change to the text goes through edit_insert() and edit_delete()
+// so it lands in the undo history. Both leave the cursor where the
+// change ends.
+
+// The change and its undo record, without the redraw bookkeeping: that
+// is done once for a key applied at many cursors.
+static void apply_insert(EditorState *ed, int y, int x, const char *text,
+                         size_t len, int *end_y, int *end_x) {
+    long t0 = trace_begin();
+    buffer_insert(&ed->buf, y, x, text, len, end_y, end_x);
+    trace_end(TRACE_EDIT, t0);
+    undo_record(&ed->undo, UNDO_INSERT, y, x, *end_y, *end_x, text, len,
+                ed->cursor_y, ed->cursor_x);
+    ed->modified = 1;
+}
+
+// Returns 0 if the range was empty.
+static int apply_delete(EditorState *ed, int y1, int x1, int y2, int x2) {
+    size_t len;
+    long t0 = trace_begin();
+    char *text = buffer_copy_range(&ed->buf, y1, x1, y2, x2, &len);
+    if (len > 0) {
+        buffer_delete_range(&ed->buf, y1, x1, y2, x2);
+        trace_end(TRACE_EDIT, t0);
+        undo_record(&ed->undo, UNDO_DELETE, y1, x1, y2, x2, text, len,
+                    ed->cursor_y, ed->cursor_x);
+        ed->modified = 1;
+    }
+    free(text);
+    return len > 0;
+}
+
+void edit_insert(EditorState *ed, int y, int x, const char *text, size_t len) {
+    if (len == 0) return;
+
+    int end_y, end_x;
+    apply_insert(ed, y, x, text, len, &end_y, &end_x);
+    mark_changed(ed, y, end_y > y ? DIRTY_TO_END : y);
+    columns_invalidate(&ed->columns, y, end_y > y ? DIRTY_TO_END : y);
+
+    ed->cursor_y = end_y;
+    ed->cursor_x = end_x;
+}
+
+void edit_delete(EditorState *ed, int y1, int x1, int y2, int x2) {
+    if (apply_delete(ed, y1, x1, y2, x2)) {
+        mark_changed(ed, y1, y2 > y1 ? DIRTY_TO_END : y1);
+        columns_invalidate(&ed->columns, y1, y2 > y1 ? DIRTY_TO_END : y1);
+    }
+
+    ed->cursor_y = y1;
+    ed->cursor_x = x1;
+}
+
+// Remove lines start..end, including the line break that joins them to
+// the rest of the file.
+static void delete_line_range(EditorState *ed, int start, int end) {
+    int last = ed->buf.line_count - 1;
+    if (end < last) {
+        edit_delete(ed, start, 0, end + 1, 0);
+    } else if (start > 0) {
+        int prev_len = buffer_line(&ed->buf, start - 1).len;
+        edit_delete(ed, start - 1, prev_len, end,
+                    buffer_line(&ed->buf, end).len);
+        ed->cursor_y = start;
+    } else {
+        edit_delete(ed, 0, 0, end, buffer_line(&ed->buf, end).len);
+    }
+    if (ed->cursor_y >= ed->buf.line_count)
+        ed->cursor_y = ed->buf.line_count - 1;
+    ed->cursor_x = 0;
+}
+
+// Ctrl+Z / Ctrl+Y
+void undo_edit(EditorState *ed, int redo) {
+    long t0 = trace_begin();
+    int top = redo ? undo_redo(&ed->undo, &ed->buf, &ed->cursor_y, &ed->cursor_x)
+                   : undo_undo(&ed->undo, &ed->buf, &ed->cursor_y, &ed->cursor_x);
+    trace_end(TRACE_EDIT, t0);
+    if (top < 0) {
+        show_message(ed, redo ? "Nothing to redo" : "Nothing to undo", 800);
+        return;
+    }
+
+    mark_changed(ed, top, DIRTY_TO_END);
+    columns_invalidate(&ed->columns, top, DIRTY_TO_END);
+    ed->selecting = SEL_NONE;
+    ed->modified = !undo_is_saved(&ed->undo);
+    scroll_if_needed(ed);
+}
+
+// Type one character, len bytes of UTF-8.
+void insert_char(EditorState *ed, const char *ch, int len) {
+    int y = ed->cursor_y;
+    int x = ed->cursor_x;
+    Line line = buffer_line(&ed->buf, y);
+
+    if (!ed->insert_mode && x < line.len) {
+        undo_begin_group(&ed->undo);
+        edit_delete(ed, y, x, y, utf8_next(line.text, line.len, x));
+        edit_insert(ed, y, x, ch, len);
+        undo_end_group(&ed->undo);
+    } else {
+        edit_insert(ed, y, x, ch, len);
+    }
+
+    scroll_if_needed(ed);
+}
+
+void delete_char_backspace(EditorState *ed) {
+    if (ed->cursor_x > 0) {
+        Line line = buffer_line(&ed->buf, ed->cursor_y);
+        edit_delete(ed, ed->cursor_y, utf8_prev(line.text, ed->cursor_x),
+                    ed->cursor_y, ed->cursor_x);
+    } else if (ed->cursor_y > 0) {
+        int prev_len = buffer_line(&ed->buf, ed->cursor_y - 1).len;
+        edit_delete(ed, ed->cursor_y - 1, prev_len, ed->cursor_y, 0);
+    }
+    scroll_if_needed(ed);
+}
+
+void delete_char_forward(EditorState *ed) {
+    Line line = buffer_line(&ed->buf, ed->cursor_y);
+    if (ed->cursor_x < line.len) {
+        edit_delete(ed, ed->cursor_y, ed->cursor_x, ed->cursor_y,
+                    utf8_next(line.text, line.len, ed->cursor_x));
+    }
+}
+
+void insert_newline(EditorState *ed) {
+    edit_insert(ed, ed->cursor_y, ed->cursor_x, "\n", 1);
+    scroll_if_needed(ed);
+}
+
+// Put lines start..end on the clipboard, joined by line breaks.
+static void copy_lines(EditorState *ed, int start, int end) {
+    clipboard_clear(&clipboard);
+    clipboard_add_range(&clipboard, &ed->buf, start, 0, end, INT_MAX);
+}
+
+// A block goes on the clipboard a row per line, and is pasted as one.
+static void copy_block(EditorState *ed, const Selection *sel) {
+    clipboard_clear(&clipboard);
+    clipboard.block = 1;
+    for (int y = sel->y1; y <= sel->y2; y++) {
+        const ColumnMap *map = columns_get(&ed->columns, &ed->buf, y);
+        clipboard_add_range(&clipboard, &ed->buf, y,
+                            columns_byte(map, sel->col1), y,
+                            columns_byte(map, sel->col2));
+        if (y < sel->y2) clipboard_add_text(&clipboard, "\n", 1);
+    }
+}
+
+// Delete the selected text and leave the cursor where it began.
+static void remove_selection(EditorState *ed, const Selection *sel) {
+    if (sel->mode == SEL_LINES) {
+        delete_line_range(ed, sel->y1, sel->y2);
+    } else if (sel->mode == SEL_CHARS) {
+        edit_delete(ed, sel->y1, sel->x1, sel->y2, sel->x2);
+    } else {
+        undo_begin_group(&ed->undo);
+        for (int y = sel->y1; y <= sel->y2; y++) {
+            const ColumnMap *map = columns_get(&ed->columns, &ed->buf, y);
+            int x1 = columns_byte(map, sel->col1);
+            int x2 = columns_byte(map, sel->col2);
+            if (x2 > x1) edit_delete(ed, y, x1, y, x2);
+        }
+        undo_end_group(&ed->undo);
+        ed->cursor_y = sel->y1;
+        ed->cursor_x = columns_byte(columns_get(&ed->columns, &ed->buf,
+                                                sel->y1), sel->col1);
+    }
+    ed->selecting = SEL_NONE;
+    scroll_if_needed(ed);
+}
+
+// Typing, Enter, Tab and pasting replace a selection of characters or
+// a block, in one undo step with what replaces it; a selection of lines
+// is only let go of. Returns 1 if it began an undo group for the caller
+// to end.
+static int replace_selection(EditorState *ed) {
+    Selection sel;
+    get_selection(ed, &sel);
+    ed->selecting = SEL_NONE;
+    if (sel.mode != SEL_CHARS && sel.mode != SEL_BLOCK) return 0;
+
+    undo_begin_group(&ed->undo);
+    remove_selection(ed, &sel);
+    return 1;
+}
+
+void copy_line(EditorState *ed) {
+    copy_lines(ed, ed->cursor_y, ed->cursor_y);
+    show_message(ed, "Line copied", 800);
+}
+
+void cut_line(EditorState *ed) {
+    copy_lines(ed, ed->cursor_y, ed->cursor_y);
+
+    delete_line_range(ed, ed->cursor_y, ed->cursor_y);
+    scroll_if_needed(ed);
+    show_message(ed, "Line cut", 800);
+}
+
+void copy_selection(EditorState *ed) {
+    Selection sel;
+    get_selection(ed, &sel);
+    if (sel.mode == SEL_NONE) {
+        copy_line(ed);
+        return;
+    }
+
+    if (sel.mode == SEL_LINES) {
+        copy_lines(ed, sel.y1, sel.y2);
+    } else if (sel.mode == SEL_BLOCK) {
+        copy_block(ed, &sel);
+    } else {
+        clipboard_clear(&clipboard);
+        clipboard_add_range(&clipboard, &ed->buf, sel.y1, sel.x1,
+                            sel.y2, sel.x2);
+    }
+    show_message(ed, "Selection copied", 800);
+}
+
+void cut_selection(EditorState *ed) {
+    Selection sel;
+    get_selection(ed, &sel);
+    if (sel.mode == SEL_NONE) {
+        cut_line(ed);
+        return;
+    }
+
+    copy_selection(ed);
+    remove_selection(ed, &sel);
+    show_message(ed, "Selection cut", 800);
+}
+
+// Returns 0 if nothing was selected.
+int delete_selection(EditorState *ed) {
+    Selection sel;
+    get_selection(ed, &sel);
+    if (sel.mode == SEL_NONE) {
+        ed->selecting = SEL_NONE;
+        return 0;
+    }
+
+    remove_selection(ed, &sel);
+    show_message(ed, "Selection deleted", 800);
+    return 1;
+}
+
+// Row i of a block goes in at the cursor's column of the i-th line
+// down, after spaces where the line is too short to reach it.
+static void paste_block(EditorState *ed, const char *text, size_t len) {
+    int y = ed->cursor_y;
+    int x = ed->cursor_x;
+    int col = cursor_col(ed);
+    const char *row = text;
+    const char *end = text + len;
+    char *padded = NULL;
+
+    for (int i = y; ; i++) {
+        const char *nl = (const char *)memchr(row, '\n', end - row);
+        size_t n = (nl ? nl : end) - row;
+        if (i == ed->buf.line_count) {
+            edit_insert(ed, i - 1, buffer_line(&ed->buf, i - 1).len, "\n", 1);
+        }
+
+        const ColumnMap *map = columns_get(&ed->columns, &ed->buf, i);
+        int pad = col > map->width ? col - map->width : 0;
+        if (n > 0) {
+            padded = (char *)realloc(padded, pad + n);
+            memset(padded, ' ', pad);
+            memcpy(padded + pad, row, n);
+            edit_insert(ed, i, columns_byte(map, col), padded, pad + n);
+        }
+
+        if (!nl) break;
+        row = nl + 1;
+    }
+    free(padded);
+
+    ed->cursor_y = y;
+    ed->cursor_x = x;
+}
+
+void paste_clipboard(EditorState *ed) {
+    if (!clipboard.copied) {
+        show_message(ed, "Clipboard is empty", 1000);
+        return;
+    }
+
+    size_t len;
+    const char *text = clipboard_text(&clipboard, &len);
+    if (!replace_selection(ed)) undo_begin_group(&ed->undo);
+    if (clipboard.block) paste_block(ed, text, len);
+    else edit_insert(ed, ed->cursor_y, ed->cursor_x, text, len);
+    undo_end_group(&ed->undo);
+    scroll_if_needed(ed);
+    show_message(ed, "Pasted", 800);
+}
+
+// NAVIGATION
+// Up and down keep the screen column; left and right step over whole
+// characters.
+void move_cursor(EditorState *ed, int dy, int dx) {
+    int col = cursor_col(ed);
+    ed->cursor_y += dy;
+
+    if (ed->cursor_y < 0) ed->cursor_y = 0;
+    if (ed->cursor_y >= ed->buf.line_count)
+        ed->cursor_y = ed->buf.line_count - 1;
+
+    if (dy != 0) {
+        ed->cursor_x = columns_byte(columns_get(&ed->columns, &ed->buf,
+                                                ed->cursor_y), col);
+    }
+
+    Line line = buffer_line(&ed->buf, ed->cursor_y);
+    if (ed->cursor_x > line.len) ed->cursor_x = line.len;
+    for (; dx > 0; dx--) {
+        ed->cursor_x = utf8_next(line.text, line.len, ed->cursor_x);
+    }
+    for (; dx < 0; dx++) ed->cursor_x = utf8_prev(line.text, ed->cursor_x);
+
+    undo_seal(&ed->undo);
+    scroll_if_needed(ed);
+}
+
+void move_to_line_start(EditorState *ed) {
+    ed->cursor_x = 0;
+    undo_seal(&ed->undo);
+    scroll_if_needed(ed);
+}
+
+void move_to_line_end(EditorState *ed) {
+    ed->cursor_x = buffer_line(&ed->buf, ed->cursor_y).len;
+    undo_seal(&ed->undo);
+    scroll_if_needed(ed);
+}
+
+void scroll_if_needed(EditorState *ed) {
+    int visible_rows = ed->view_rows;
+    int visible_cols = ed->view_cols - gutter_width(ed);
+
+    if (ed->cursor_y < ed->offset_y) {
+        ed->offset_y = ed->cursor_y;
+    } else if (ed->cursor_y >= ed->offset_y + visible_rows) {
+        ed->offset_y = ed->cursor_y - visible_rows + 1;
+    }
+
+    // Keep the whole character under the cursor in view.
+    const ColumnMap *map = columns_get(&ed->columns, &ed->buf, ed->cursor_y);
+    Line line = buffer_line(&ed->buf, ed->cursor_y);
+    int col = columns_col(map, ed->cursor_x);
+    int end = columns_col(map, utf8_next(line.text, line.len, ed->cursor_x));
+    if (end <= col) end = col + 1;
+
+    if (col < ed->offset_x) {
+        ed->offset_x = col;
+    } else if (end > ed->offset_x + visible_cols) {
+        ed->offset_x = end - visible_cols;
+    }
+}
+
+// Screen column of the cursor, counted from the start of the line.
+int cursor_col(EditorState *ed) {
+    return columns_col(columns_get(&ed->columns, &ed->buf, ed->cursor_y),
+                       ed->cursor_x);
+}
+
+// Columns left of the text: the widest line number, at least four
+// digits, and a space.
+int gutter_width(EditorState *ed) {
+    int digits = 4;
+    for (int n = ed->buf.line_count; n >= 10000; n /= 10) digits++;
+    return digits + 1;
+}
+
+// PgUp/PgDn: a screen less one line, with the text scrolling along so
+// the cursor stays on its row.
+void move_page(EditorState *ed, int dir) {
+    int page = ed->view_rows > 1 ? ed->view_rows - 1 : 1;
+    int row = ed->cursor_y - ed->offset_y;
+    move_cursor(ed, dir * page, 0);
+
+    int top = ed->cursor_y - row;
+    int last_top = ed->buf.line_count - ed->view_rows;
+    if (top > last_top) top = last_top;
+    if (top < 0) top = 0;
+    if (top <= ed->cursor_y && ed->cursor_y < top + ed->view_rows) {
+        ed->offset_y = top;
+    }
+}
+
+// JUMPS
+// Line numbers and byte offsets are looked up in the buffer's block tree
+// and the file's line index, both in O(log n).
+static void place_cursor(EditorState *ed, int y, int x) {
+    if (y < ed->offset_y || y >= ed->offset_y + ed->view_rows) {
+        int top = y - ed->view_rows / 2;
+        int last_top = ed->buf.line_count - ed->view_rows;
+        if (top > last_top) top = last_top;
+        ed->offset_y = top > 0 ? top : 0;
+    }
+
+    // An offset can fall inside a character.
+    Line line = buffer_line(&ed->buf, y);
+    while (x > 0 && x < line.len && (line.text[x] & 0xC0) == 0x80) x--;
+    ed->cursor_y = y;
+    ed->cursor_x = x;
+    undo_seal(&ed->undo);
+    scroll_if_needed(ed);
+}
+
+// Where byte `offset` of the file is now. Returns 0 if that part of the
+// file has not been indexed yet, and gives the last line loaded.
+static int offset_position(EditorState *ed, size_t offset, int *y, int *x) {
+    Buffer *buf = &ed->buf;
+    int last = buf->line_count - 1;
+    *y = last;
+    *x = buffer_line(buf, last).len;
+
+    if (!buf->index) {
+        // A new buffer: count through what has been typed.
+        BufferIter it;
+        buffer_iter_init(&it, buf, 0);
+        for (int i = 0; i <= last; i++) {
+            Line line = buffer_iter_next(&it);
+            if (offset <= (size_t)line.len) {
+                *y = i;
+                *x = (int)offset;
+                return 1;
+            }
+            offset -= line.len + 1;
+        }
+        return 1;
+    }
+
+    int n = lineindex_line_at(buf->index, offset);
+    if (n >= buf->indexed) return !buffer_loading(buf);
+
+    size_t start, end;
+    lineindex_span(buf->index, n, &start, &end);
+    *y = buffer_image_line(buf, n);
+    Line line = buffer_line(buf, *y);
+    *x = offset - start < (size_t)line.len ? (int)(offset - start) : line.len;
+    return 1;
+}
+
+// Move the cursor as close to the jump's target as the loaded lines go.
+// Returns 1 once it got there.
+static int resolve_jump(EditorState *ed) {
+    Jump *j = &ed->jump;
+    int last = ed->buf.line_count - 1;
+    int loading = buffer_loading(&ed->buf);
+    int reached = 1;
+    int y = last;
+    int x = 0;
+
+    if (j->kind == JUMP_LINE) {
+        if (j->target <= (size_t)last) y = (int)j->target;
+        else reached = !loading;
+    } else if (j->kind == JUMP_END) {
+        x = buffer_line(&ed->buf, last).len;
+        reached = !loading;
+    } else if (j->kind == JUMP_OFFSET) {
+        reached = offset_position(ed, j->target, &y, &x);
+    }
+
+    place_cursor(ed, y, x);
+    j->y = y;
+    j->x = x;
+    if (reached) j->kind = JUMP_NONE;
+    return reached;
+}
+
+static void start_jump(EditorState *ed, int kind, size_t target) {
+    ed->jump.kind = kind;
+    ed->jump.target = target;
+    if (!resolve_jump(ed)) {
+        show_message(ed, "Still loading; the cursor moves on as lines come in",
+                     1500);
+    }
+}
+
+// Carry on with a jump once the indexer has added lines, unless the
+// cursor was moved since.
+static void refine_jump(EditorState *ed) {
+    Jump *j = &ed->jump;
+    if (ed->cursor_y != j->y || ed->cursor_x != j->x) {
+        j->kind = JUMP_NONE;
+        return;
+    }
+    resolve_jump(ed);
+}
+
+// Line y (0-based), or the last line loaded until it is.
+void jump_to_line(EditorState *ed, int y) {
+    start_jump(ed, JUMP_LINE, y > 0 ? (size_t)y : 0);
+}
+
+// Byte offset into the file as it was opened.
+void jump_to_offset(EditorState *ed, size_t offset) {
+    start_jump(ed, JUMP_OFFSET, offset);
+}
+
+void jump_to_start(EditorState *ed) {
+    ed->jump.kind = JUMP_NONE;
+    place_cursor(ed, 0, 0);
+}
+
+void jump_to_end(EditorState *ed) {
+    start_jump(ed, JUMP_END, 0);
+}
+
+// Ctrl+G: "120" goes to line 120, "@4096" to byte 4096 of the file.
+// Returns -1 if `where` is neither.
+int go_to(EditorState *ed, const char *where) {
+    while (*where == ' ') where++;
+    int offset = *where == '@';
+    if (offset) where++;
+    if (*where < '0' || *where > '9') return -1;
+
+    char *end;
+    unsigned long long n = strtoull(where, &end, 10);
+    while (*end == ' ') end++;
+    if (*end) return -1;
+
+    if (offset) jump_to_offset(ed, (size_t)n);
+    else jump_to_line(ed, n > INT_MAX ? INT_MAX : (int)n - 1);
+    return 0;
+}
+
+// SELECTION
+// Only where the selection was started is kept; the other end is the
+// cursor, so moving never has to update it.
+void get_selection(EditorState *ed, Selection *sel) {
+    memset(sel, 0, sizeof(Selection));
+    int last = ed->buf.line_count - 1;
+    int y1 = ed->sel_y < last ? ed->sel_y : last;
+    int x1 = ed->sel_x;
+    int y2 = ed->cursor_y;
+    int x2 = ed->cursor_x;
+
+    if (ed->selecting == SEL_CHARS) {
+        // The line it was started on may have got shorter since.
+        int len = buffer_line(&ed->buf, y1).len;
+        if (x1 > len) x1 = len;
+        if (y1 == y2 && x1 == x2) return;
+    }
+    if (y1 > y2 || (y1 == y2 && x1 > x2)) {
+        int t = y1; y1 = y2; y2 = t;
+        t = x1; x1 = x2; x2 = t;
+    }
+
+    sel->mode = ed->selecting;
+    sel->y1 = y1;
+    sel->x1 = x1;
+    sel->y2 = y2;
+    sel->x2 = x2;
+    sel->col1 = ed->sel_col < ed->block_col ? ed->sel_col : ed->block_col;
+    sel->col2 = ed->sel_col < ed->block_col ? ed->block_col : ed->sel_col;
+}
+
+// Start a selection of the given mode at the cursor, unless one is
+// already going.
+void start_selection(EditorState *ed, int mode) {
+    if (ed->selecting == mode) return;
+    ed->selecting = mode;
+    ed->sel_y = ed->cursor_y;
+    ed->sel_x = ed->cursor_x;
+    ed->sel_col = ed->block_col = cursor_col(ed);
+}
+
+// Ctrl+A
+void select_all(EditorState *ed) {
+    buffer_finish(&ed->buf);
+    mark_all_dirty(ed);
+    ed->selecting = SEL_CHARS;
+    ed->sel_y = ed->sel_x = 0;
+    ed->cursor_y = ed->buf.line_count - 1;
+    move_to_line_end(ed);
+}
+
+// Moving without Shift lets go of a Shift or block selection; one of
+// lines (F2) follows the cursor.
+static void leave_selection(EditorState *ed) {
+    if (ed->selecting != SEL_LINES) ed->selecting = SEL_NONE;
+}
+
+// Alt+Shift+arrows move by columns, past the ends of short lines, so
+// the block keeps its shape over them.
+static void move_block(EditorState *ed, int dy, int dcol) {
+    ed->block_col += dcol;
+    if (ed->block_col < 0) ed->block_col = 0;
+    ed->cursor_y += dy;
+    if (ed->cursor_y < 0) ed->cursor_y = 0;
+    if (ed->cursor_y >= ed->buf.line_count)
+        ed->cursor_y = ed->buf.line_count - 1;
+    ed->cursor_x = columns_byte(columns_get(&ed->columns, &ed->buf,
+                                            ed->cursor_y), ed->block_col);
+    undo_seal(&ed->undo);
+    scroll_if_needed(ed);
+}
+
+// MULTIPLE CURSORS
+// A key that edits is applied at every cursor as one undo step. The
+// cursors are visited in file order, and what each edit does to the
+// ones after it is kept as one shift instead of moving them all every
+// time; the screen is marked for redraw once, for all of them.
+
+// What a key does at each cursor.
+#define CARET_TYPE 0           // Type text, over a character if overwriting
+#define CARET_INSERT 1         // Insert text
+#define CARET_LINES 2          // Insert the next line of text at each
+#define CARET_BACKSPACE 3
+#define CARET_DELETE 4
+
+// Where the edits so far moved the text after them.
+typedef struct {
+    int line;                  // Line (numbered as before) the last edit
+    int y;                     // ended on, and where it is now
+    int dx;                    // Bytes the rest of that line moved by
+    int dy;                    // Lines every line after it moved by
+} CaretShift;
+
+static Caret caret_shifted(const CaretShift *s, Caret c) {
+    if (c.y == s->line) return (Caret){s->y, c.x + s->dx};
+    return (Caret){c.y + s->dy, c.x};
+}
+
+// Text was inserted at cur, the cursor that was at c, up to (y, x).
+static void shift_insert(CaretShift *s, Caret c, Caret cur, int y, int x) {
+    int dx = s->line == c.y ? s->dx : 0;
+    s->dy += y - cur.y;
+    s->dx = x - cur.x + dx;
+    s->line = c.y;
+    s->y = y;
+}
+
+// Text from (y1, x1) to (y2, x2) went, at the cursor that was at c.
+static void shift_delete(CaretShift *s, Caret c, Caret cur,
+                         int y1, int x1, int y2, int x2) {
+    int line = y2 == cur.y ? c.y : y2 - s->dy;
+    int dx = s->line == line ? s->dx : 0;
+    s->dy -= y2 - y1;
+    s->dx = x1 - x2 + dx;
+    s->line = line;
+    s->y = y1;
+}
+
+static int caret_cmp(const void *a, const void *b) {
+    const Caret *p = (const Caret *)a;
+    const Caret *q = (const Caret *)b;
+    if (p->y != q->y) return p->y < q->y ? -1 : 1;
+    return (p->x > q->x) - (p->x < q->x);
+}
+
+static void add_caret(EditorState *ed, int y, int x) {
+    if (ed->caret_count == ed->caret_cap) {
+        ed->caret_cap = ed->caret_cap ? ed->caret_cap * 2 : 64;
+        ed->carets = (Caret *)realloc(ed->carets,
+                                      ed->caret_cap * sizeof(Caret));
+    }
+    ed->carets[ed->caret_count++] = (Caret){y, x};
+}
+
+// First cursor on line y or after it.
+int caret_first(EditorState *ed, int y) {
+    int lo = 0;
+    int hi = ed->caret_count;
+    while (lo < hi) {
+        int mid = lo + (hi - lo) / 2;
+        if (ed->carets[mid].y < y) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo;
+}
+
+// The main cursor joins the others for a key; returns its place.
+static int join_carets(EditorState *ed) {
+    Caret main = {ed->cursor_y, ed->cursor_x};
+    int at = caret_first(ed, main.y);
+    while (at < ed->caret_count && ed->carets[at].y == main.y &&
+           ed->carets[at].x < main.x) {
+        at++;
+    }
+    add_caret(ed, 0, 0);
+    memmove(&ed->carets[at + 1], &ed->carets[at],
+            (ed->caret_count - at - 1) * sizeof(Caret));
+    ed->carets[at] = main;
+    return at;
+}
+
+// And leaves them again: cursors that ran into each other are merged.
+static void part_carets(EditorState *ed, int main) {
+    Caret m = ed->carets[main];
+    Caret *c = ed->carets;
+    int n = ed->caret_count;
+    int sorted = 1;
+    for (int i = 1; i < n && sorted; i++) sorted = caret_cmp(&c[i - 1], &c[i]) <= 0;
+    if (!sorted) qsort(c, n, sizeof(Caret), caret_cmp);
+
+    int kept = 0;
+    for (int i = 0; i < n; i++) {
+        if (kept > 0 && caret_cmp(&c[kept - 1], &c[i]) == 0) continue;
+        if (c[i].y == m.y && c[i].x == m.x) continue;
+        c[kept++] = c[i];
+    }
+    ed->caret_count = kept;
+    ed->cursor_y = m.y;
+    ed->cursor_x = m.x;
+}
+
+// Repaint the rows the cursors are on before and after a change.
+static void mark_carets(EditorState *ed, int from, int to) {
+    if (ed->caret_count > 0) {
+        if (ed->carets[0].y < from) from = ed->carets[0].y;
+        if (ed->carets[ed->caret_count - 1].y > to)
+            to = ed->carets[ed->caret_count - 1].y;
+    }
+    if (ed->cursor_y < from) from = ed->cursor_y;
+    if (ed->cursor_y > to) to = ed->cursor_y;
+    mark_dirty(ed, from, to);
+}
+
+void drop_carets(EditorState *ed) {
+    if (ed->caret_count == 0) return;
+    mark_carets(ed, ed->cursor_y, ed->cursor_y);
+    ed->caret_count = 0;
+}
+
+static void edit_carets(EditorState *ed, int op, const char *text,
+                        size_t len) {
+    int main = join_carets(ed);
+    Caret *c = ed->carets;
+    int n = ed->caret_count;
+    int lines = ed->buf.line_count;
+    int from = c[0].y > 0 ? c[0].y - 1 : 0;
+    const char *next = text;
+    const char *end = text + len;
+    CaretShift s = {-1, 0, 0, 0};
+
+    ed->selecting = SEL_NONE;
+    undo_begin_group(&ed->undo);
+    for (int i = 0; i < n; i++) {
+        Caret cur = caret_shifted(&s, c[i]);
+        Line line = buffer_line(&ed->buf, cur.y);
+        if (cur.x > line.len) cur.x = line.len;
+
+        if (op == CARET_BACKSPACE || op == CARET_DELETE ||
+            (op == CARET_TYPE && !ed->insert_mode && cur.x < line.len)) {
+            int y1 = cur.y, x1 = cur.x, y2 = cur.y, x2 = cur.x;
+            if (op == CARET_BACKSPACE && cur.x > 0) {
+                x1 = utf8_prev(line.text, cur.x);
+            } else if (op == CARET_BACKSPACE && cur.y > 0) {
+                y1 = cur.y - 1;
+                x1 = buffer_line(&ed->buf, y1).len;
+            } else if (op != CARET_BACKSPACE && cur.x < line.len) {
+                x2 = utf8_next(line.text, line.len, cur.x);
+            } else if (op != CARET_BACKSPACE &&
+                       cur.y + 1 < ed->buf.line_count) {
+                y2 = cur.y + 1;
+                x2 = 0;
+            }
+            if (apply_delete(ed, y1, x1, y2, x2)) {
+                shift_delete(&s, c[i], cur, y1, x1, y2, x2);
+            }
+            cur = (Caret){y1, x1};
+        }
+
+        const char *piece = text;
+        size_t piece_len = len;
+        if (op == CARET_LINES) {
+            const char *nl = (const char *)memchr(next, '\n', end - next);
+            piece = next;
+            piece_len = (nl ? nl : end) - next;
+            next = nl ? nl + 1 : end;
+        }
+        if (op <= CARET_LINES && piece_len > 0) {
+            int y, x;
+            apply_insert(ed, cur.y, cur.x, piece, piece_len, &y, &x);
+            shift_insert(&s, c[i], cur, y, x);
+            cur = (Caret){y, x};
+        }
+        c[i] = cur;
+    }
+    undo_end_group(&ed->undo);
+
+    int to = ed->buf.line_count != lines ? DIRTY_TO_END : c[n - 1].y;
+    mark_changed(ed, from, to);
+    columns_invalidate(&ed->columns, from, to);
+    part_carets(ed, main);
+    scroll_if_needed(ed);
+}
+
+// Arrows, Home and End move every cursor.
+static void move_carets(EditorState *ed, int ch) {
+    int main = join_carets(ed);
+    Caret *c = ed->carets;
+    int n = ed->caret_count;
+    mark_dirty(ed, c[0].y, c[n - 1].y);
+
+    for (int i = 0; i < n; i++) {
+        Line line = buffer_line(&ed->buf, c[i].y);
+        if (c[i].x > line.len) c[i].x = line.len;
+
+        if (ch == K_LEFT) {
+            c[i].x = utf8_prev(line.text, c[i].x);
+        } else if (ch == K_RIGHT) {
+            c[i].x = utf8_next(line.text, line.len, c[i].x);
+        } else if (ch == K_HOME) {
+            c[i].x = 0;
+        } else if (ch == K_END) {
+            c[i].x = line.len;
+        } else {
+            int col = columns_col(columns_get(&ed->columns, &ed->buf,
+                                              c[i].y), c[i].x);
+            c[i].y += ch == K_UP ? -1 : 1;
+            if (c[i].y < 0) c[i].y = 0;
+            if (c[i].y >= ed->buf.line_count) c[i].y = ed->buf.line_count - 1;
+            c[i].x = columns_byte(columns_get(&ed->columns, &ed->buf,
+                                              c[i].y), col);
+        }
+    }
+
+    part_carets(ed, main);
+    mark_carets(ed, ed->cursor_y, ed->cursor_y);
+    undo_seal(&ed->undo);
+    scroll_if_needed(ed);
+}
+
+// A paste goes in at every cursor, or a line of it at each if it has
+// as many lines as there are cursors.
+static void paste_carets(EditorState *ed, const char *text, size_t len) {
+    int rows = 1;
+    for (const char *p = text; (p = memchr(p, '\n', text + len - p)); p++) {
+        rows++;
+    }
+    edit_carets(ed, rows == ed->caret_count + 1 ? CARET_LINES : CARET_INSERT,
+                text, len);
+}
+
+static void show_carets(EditorState *ed) {
+    char msg[64];
+    snprintf(msg, sizeof(msg), "%d cursors%s", ed->caret_count + 1,
+             ed->caret_count == CARETS_MAX ? " (the most there can be)" : "");
+    show_message(ed, msg, 1000);
+}
+
+// Ctrl+L: a cursor on every line of the selection, in the cursor's
+// column (or at the end of a line too short to reach it).
+void carets_from_selection(EditorState *ed) {
+    Selection sel;
+    get_selection(ed, &sel);
+    if (sel.mode == SEL_NONE) {
+        show_message(ed, "Select the lines first", 1000);
+        return;
+    }
+
+    drop_carets(ed);
+    int col = sel.mode == SEL_BLOCK ? ed->block_col : cursor_col(ed);
+    for (int y = sel.y1; y <= sel.y2 && ed->caret_count < CARETS_MAX; y++) {
+        if (y == ed->cursor_y) continue;
+        add_caret(ed, y, columns_byte(columns_get(&ed->columns, &ed->buf, y),
+                                      col));
+    }
+    ed->selecting = SEL_NONE;
+    mark_dirty(ed, sel.y1, sel.y2);
+    show_carets(ed);
+}
+
+// Ctrl+D: a cursor at every match of the last search. The main one is
+// the first match from the cursor on.
+void carets_from_search(EditorState *ed) {
+    SearchIndex *s = &ed->search;
+    SearchHit hit;
+    if (s->len == 0 || !search_next(s, &ed->buf, 0, 0, 1, &hit)) {
+        show_message(ed, s->len ? "Not found" : "Search first (Ctrl+F)", 1000);
+        return;
+    }
+
+    drop_carets(ed);
+    Caret prev;
+    do {
+        add_caret(ed, hit.y, hit.x);
+        prev = (Caret){hit.y, hit.x};
+    } while (ed->caret_count <= CARETS_MAX &&
+             search_next(s, &ed->buf, hit.y, hit.x + (int)s->len - 1, 0,
+                         &hit) &&
+             caret_cmp(&(Caret){hit.y, hit.x}, &prev) > 0);
+
+    Caret *c = ed->carets;
+    int main = caret_first(ed, ed->cursor_y);
+    while (main < ed->caret_count && c[main].y == ed->cursor_y &&
+           c[main].x < ed->cursor_x) {
+        main++;
+    }
+    if (main == ed->caret_count) main = 0;
+    part_carets(ed, main);
+
+    ed->selecting = SEL_NONE;
+    undo_seal(&ed->undo);
+    mark_carets(ed, ed->cursor_y, ed->cursor_y);
+    scroll_if_needed(ed);
+    show_carets(ed);
+}
+
+// Keys with more than one cursor. Returns 0 for the keys that work as
+// usual, after dropping the other cursors if the key would leave them
+// behind.
+static int caret_key(EditorState *ed, int ch) {
+    char tab[TAB_SIZE];
+
+    switch (ch) {
+        case '\n':
+            edit_carets(ed, CARET_INSERT, "\n", 1);
+            return 1;
+
+        case '\t':
+            memset(tab, ' ', TAB_SIZE);
+            edit_carets(ed, CARET_INSERT, tab, TAB_SIZE);
+            return 1;
+
+        case 127:
+        case 8:
+            edit_carets(ed, CARET_BACKSPACE, NULL, 0);
+            return 1;
+
+        case K_DELETE:
+            edit_carets(ed, CARET_DELETE, NULL, 0);
+            return 1;
+
+        case K_UP:
+        case K_DOWN:
+        case K_LEFT:
+        case K_RIGHT:
+        case K_HOME:
+        case K_END:
+            move_carets(ed, ch);
+            return 1;
+
+        case 22:  // Ctrl+V
+        {
+            if (!clipboard.copied) return 0;
+            size_t len;
+            const char *text = clipboard_text(&clipboard, &len);
+            paste_carets(ed, text, len);
+            show_message(ed, "Pasted", 800);
+        }
+            return 1;
+
+        case 27:  // Esc
+            drop_carets(ed);
+            return 1;
+
+        case K_INSERT:
+        case 12:  // Ctrl+L
+        case 4:   // Ctrl+D
+            return 0;
+    }
+    drop_carets(ed);
+    return 0;
+}
+
+// KEYS
+// The keys that edit or move around the text, whatever they come from.
+// Keys the front end does not handle itself are passed on here.
+void edit_key(EditorState *ed, int ch) {
+    int group;
+
+    if (ed->caret_count > 0 && caret_key(ed, ch)) return;
+
+    switch (ch) {
+        // SELECTION
+        case K_F2:  // Toggle selection mode
+            if (ed->selecting != SEL_LINES) {
+                start_selection(ed, SEL_LINES);
+                show_message(ed, "Selection started", 800);
+            } else {
+                ed->selecting = SEL_NONE;
+                show_message(ed, "Selection cleared", 800);
+            }
+            break;
+
+        case 1:  // Ctrl+A
+            select_all(ed);
+            break;
+
+        // MULTIPLE CURSORS
+        case 12:  // Ctrl+L
+            carets_from_selection(ed);
+            break;
+
+        case 4:  // Ctrl+D
+            carets_from_search(ed);
+            break;
+
+        case K_SHIFT_UP:  // Shift+Up
+            start_selection(ed, SEL_CHARS);
+            move_cursor(ed, -1, 0);
+            break;
+
+        case K_SHIFT_DOWN:  // Shift+Down
+            start_selection(ed, SEL_CHARS);
+            move_cursor(ed, 1, 0);
+            break;
+
+        case K_SHIFT_LEFT:
+            start_selection(ed, SEL_CHARS);
+            move_cursor(ed, 0, -1);
+            break;
+
+        case K_SHIFT_RIGHT:
+            start_selection(ed, SEL_CHARS);
+            move_cursor(ed, 0, 1);
+            break;
+
+        case K_SHIFT_HOME:
+            start_selection(ed, SEL_CHARS);
+            move_to_line_start(ed);
+            break;
+
+        case K_SHIFT_END:
+            start_selection(ed, SEL_CHARS);
+            move_to_line_end(ed);
+            break;
+
+        case K_SHIFT_PGUP:
+            start_selection(ed, SEL_CHARS);
+            move_page(ed, -1);
+            break;
+
+        case K_SHIFT_PGDN:
+            start_selection(ed, SEL_CHARS);
+            move_page(ed, 1);
+            break;
+
+        case K_BLOCK_UP:
+            start_selection(ed, SEL_BLOCK);
+            move_block(ed, -1, 0);
+            break;
+
+        case K_BLOCK_DOWN:
+            start_selection(ed, SEL_BLOCK);
+            move_block(ed, 1, 0);
+            break;
+
+        case K_BLOCK_LEFT:
+            start_selection(ed, SEL_BLOCK);
+            move_block(ed, 0, -1);
+            break;
+
+        case K_BLOCK_RIGHT:
+            start_selection(ed, SEL_BLOCK);
+            move_block(ed, 0, 1);
+            break;
+
+        // EDIT
+        case 3:  // Ctrl+C
+            if (ed->selecting) copy_selection(ed);
+            else copy_line(ed);
+            break;
+
+        case 24:  // Ctrl+X
+            if (ed->selecting) cut_selection(ed);
+            else cut_line(ed);
+            break;
+
+        case 22:  // Ctrl+V
+            paste_clipboard(ed);
+            break;
+
+        case 26:  // Ctrl+Z
+            undo_edit(ed, 0);
+            break;
+
+        case 25:  // Ctrl+Y
+            undo_edit(ed, 1);
+            break;
+
+        case K_INSERT:
+            ed->insert_mode = !ed->insert_mode;
+            break;
+
+        // NAVIGATION
+        case K_UP:
+            leave_selection(ed);
+            move_cursor(ed, -1, 0);
+            break;
+
+        case K_DOWN:
+            leave_selection(ed);
+            move_cursor(ed, 1, 0);
+            break;
+
+        case K_LEFT:
+            leave_selection(ed);
+            move_cursor(ed, 0, -1);
+            break;
+
+        case K_RIGHT:
+            leave_selection(ed);
+            move_cursor(ed, 0, 1);
+            break;
+
+        case K_HOME:
+            leave_selection(ed);
+            move_to_line_start(ed);
+            break;
+
+        case K_END:
+            leave_selection(ed);
+            move_to_line_end(ed);
+            break;
+
+        case K_PGUP:
+            leave_selection(ed);
+            move_page(ed, -1);
+            break;
+
+        case K_PGDN:
+            leave_selection(ed);
+            move_page(ed, 1);
+            break;
+
+        case K_FILE_START:
+            leave_selection(ed);
+            jump_to_start(ed);
+            break;
+
+        case K_FILE_END:
+            leave_selection(ed);
+            jump_to_end(ed);
+            break;
+
+        // TEXT
+        case '\n':
+            group = replace_selection(ed);
+            insert_newline(ed);
+            if (group) undo_end_group(&ed->undo);
+            break;
+
+        case 127:
+        case 8:
+            if (!delete_selection(ed)) delete_char_backspace(ed);
+            break;
+
+        case K_DELETE:
+            if (!delete_selection(ed)) delete_char_forward(ed);
+            break;
+
+        case '\t':
+            group = replace_selection(ed);
+            for (int i = 0; i < TAB_SIZE; i++) {
+                insert_char(ed, " ", 1);
+            }
+            if (group) undo_end_group(&ed->undo);
+            break;
+    }
+}
+
+// A typed character, len bytes of UTF-8.
+void type_char(EditorState *ed, const char *ch, int len) {
+    if (ed->caret_count > 0) {
+        edit_carets(ed, CARET_TYPE, ch, len);
+        return;
+    }
+
+    int group = replace_selection(ed);
+    insert_char(ed, ch, len);
+    if (group) undo_end_group(&ed->undo);
+}
+
+// A paste from the terminal, which goes wherever Ctrl+V would put the
+// same text: at every cursor, or in place of a selection. Each '\n'
+// starts a new line; it always inserts, even in overwrite mode.
+void paste_text(EditorState *ed, const char *text, size_t len) {
+    if (ed->caret_count > 0) {
+        paste_carets(ed, text, len);
+        return;
+    }
+
+    int group = replace_selection(ed);
+    edit_insert(ed, ed->cursor_y, ed->cursor_x, text, len);
+    if (group) undo_end_group(&ed->undo);
+    scroll_if_needed(ed);
+}
+
+// KEY NAMES
+// What keystroke scripts call the keys edit_key() takes.
+static const struct {
+    const char *name;
+    int code;
+} key_names[] = {
+    {"Enter", '\n'}, {"Backspace", 127}, {"Delete", K_DELETE}, {"Tab", '\t'},
+    {"Insert", K_INSERT}, {"Up", K_UP}, {"Down", K_DOWN},
+    {"Left", K_LEFT}, {"Right", K_RIGHT}, {"Home", K_HOME},
+    {"End", K_END}, {"PgUp", K_PGUP}, {"PgDn", K_PGDN},
+    {"F2", K_F2}, {"Ctrl+C", 3}, {"Ctrl+X", 24}, {"Ctrl+V", 22},
+    {"Ctrl+Z", 26}, {"Ctrl+Y", 25}, {"Ctrl+A", 1},
+    {"Shift+Up", K_SHIFT_UP}, {"Shift+Down", K_SHIFT_DOWN},
+    {"Shift+Left", K_SHIFT_LEFT}, {"Shift+Right", K_SHIFT_RIGHT},
+    {"Shift+Home", K_SHIFT_HOME}, {"Shift+End", K_SHIFT_END},
+    {"Shift+PgUp", K_SHIFT_PGUP}, {"Shift+PgDn", K_SHIFT_PGDN},
+    {"Alt+Shift+Up", K_BLOCK_UP}, {"Alt+Shift+Down", K_BLOCK_DOWN},
+    {"Alt+Shift+Left", K_BLOCK_LEFT}, {"Alt+Shift+Right", K_BLOCK_RIGHT},
+    {"Ctrl+L", 12}, {"Ctrl+D", 4}, {"Esc", 27},
+    {"Ctrl+Home", K_FILE_START}, {"Ctrl+End", K_FILE_END},
+};
+
+// NULL if ch is not an editing key.
+const char *key_name(int ch) {
+    for (size_t i = 0; i < sizeof(key_names) / sizeof(key_names[0]); i++) {
+        if (key_names[i].code == ch) return key_names[i].name;
+    }
+    return NULL;
+}
+
+// -1 if there is no key of that name.
+int key_code(const char *name) {
+    for (size_t i = 0; i < sizeof(key_names) / sizeof(key_names[0]); i++) {
+        if (strcmp(key_names[i].name, name) == 0) return key_names[i].code;
+    }
+    return -1;
+}
@@ -0,0 +1,328 @@
+/*
+ * LIWIT - Linux-Windows Text Editor
+ * Copyright (C) 2026  Khud Bakhtiyar Iqbal Sofi
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Editing core.
+ *
+ * Everything the editor does to a file, from the keys that edit it to
+ * opening and saving it, without a terminal. liwit.c draws EditorState
+ * and feeds it keys; tests/bench_replay.c does the same headless. Of
+ * the screen the core only knows the size of each pane and which lines
+ * changed since the last paint; windows and what was painted in them
+ * are the front end's.
+ */
+
+#ifndef LIWIT_EDITOR_H
+#define LIWIT_EDITOR_H
+
+#include <limits.h>
+#include "buffer.h"
+#include "undo.h"
+#include "journal.h"
+#include "follow.h"
+#include "search.h"
+#include "replace.h"
+#include "syntax.h"
+#include "utf8.h"
+#include "trace.h"
+#include "clipboard.h"
+
+// CONFIGURATION
+#define TAB_SIZE 4
+#define DIRTY_TO_END INT_MAX   // mark_dirty(): repaint down to the last line
+#define SAVE_FSYNC 1           // 1 to fsync saved files before replacing them
+#define MESSAGE_QUEUE 8        // Status messages waiting to be shown
+#define MESSAGE_MIN_MS 400     // Shortest time a message stays up
+#define FOLLOW_READ_BYTES (16 << 20)  // Appended bytes taken in per poll
+#define CARETS_MAX 100000      // Most cursors Ctrl+L or Ctrl+D adds
+
+// KEYS
+// edit_key() takes characters, Ctrl+letters and Esc as their own codes
+// ('\n' is Enter, 127 and 8 Backspace) and the other keys as these. The
+// front end maps the codes its terminal library gives keys onto them.
+enum {
+    K_UP = 0x100,              // Past any byte
+    K_DOWN,
+    K_LEFT,
+    K_RIGHT,
+    K_HOME,
+    K_END,
+    K_PGUP,
+    K_PGDN,
+    K_DELETE,
+    K_INSERT,
+    K_F2,
+    K_SHIFT_UP,
+    K_SHIFT_DOWN,
+    K_SHIFT_LEFT,
+    K_SHIFT_RIGHT,
+    K_SHIFT_HOME,
+    K_SHIFT_END,
+    K_SHIFT_PGUP,
+    K_SHIFT_PGDN,
+    K_BLOCK_UP,                // Alt+Shift+arrows
+    K_BLOCK_DOWN,
+    K_BLOCK_LEFT,
+    K_BLOCK_RIGHT,
+    K_FILE_START,              // Ctrl+Home
+    K_FILE_END                 // Ctrl+End
+};
+
+// Selection modes
+#define SEL_NONE 0
+#define SEL_LINES 1            // Whole lines (F2)
+#define SEL_CHARS 2            // From one character to another (Shift)
+#define SEL_BLOCK 3            // A rectangle of columns (Alt+Shift)
+
+// Jump targets
+#define JUMP_NONE 0
+#define JUMP_LINE 1            // A line (Ctrl+G)
+#define JUMP_OFFSET 2          // A byte offset into the file (Ctrl+G @n)
+#define JUMP_END 3             // The end of the file (Ctrl+End)
+
+// DATA STRUCTURES
+typedef struct {
+    char text[160];
+    int duration_ms;
+} Message;
+
+typedef struct {
+    int y;
+    int x;
+} Caret;
+
+// A selection in file order, worked out from where it was started and
+// the cursor.
+typedef struct {
+    int mode;                  // SEL_*
+    int y1, x1;                // First line, and byte in it (SEL_CHARS)
+    int y2, x2;                // Last line, and byte after the end
+    int col1, col2;            // Columns of a block, col2 excluded
+} Selection;
+
+// A jump past the lines loaded so far. The cursor goes as far as it can
+// and moves on as the indexer adds lines, until it gets there or the
+// user moves it.
+typedef struct {
+    int kind;                  // JUMP_*, JUMP_NONE once it got there
+    size_t target;             // Line or byte offset
+    int y;                     // Where the cursor was put for now
+    int x;
+} Jump;
+
+// An open file. The active one is worked on in EditorState; the others
+// wait here until they are switched to.
+typedef struct {
+    Buffer buf;
+    UndoLog undo;
+    SearchIndex search;
+    Syntax syntax;
+    ColumnCache columns;
+    char *filename;
+    char *pending;             // File to open when first shown, or NULL
+    int pending_follow;        // 1 to follow that file
+    Follow *follow;
+    int modified;
+    int cursor_x;
+    int cursor_y;
+    int offset_x;
+    int offset_y;
+    int selecting;
+    int sel_y;
+    int sel_x;
+    int sel_col;
+    int block_col;
+    int trimmed;               // 1 once its file image was let go
+} Tab;
+
+// A window onto a tab. Like the active tab, the active pane is worked on
+// in EditorState; only its place on the screen is kept up to date here.
+typedef struct {
+    int tab;                   // Tab shown
+    int top;                   // Screen area, including the border on
+    int left;                  // the right and bottom edges if another
+    int height;                // pane lies beyond them
+    int width;
+
+    int rows;                  // Size of the text area
+    int cols;
+    int cursor_x;
+    int cursor_y;
+    int offset_x;
+    int offset_y;
+    int selecting;
+    int sel_y;
+    int sel_x;
+    int sel_col;
+    int block_col;
+    int dirty_from;
+    int dirty_to;
+    int dirty_all;
+    Caret *carets;
+    int caret_count;
+    int caret_cap;
+} Pane;
+
+typedef struct EditorState {
+    Buffer buf;                // Text lines
+    UndoLog undo;              // Undo/redo history of buf
+    int cursor_x;              // Cursor byte offset in the line (0-based)
+    int cursor_y;              // Cursor row position (0-based)
+    int offset_x;              // Horizontal scroll offset (columns)
+    int offset_y;              // Vertical scroll offset
+    int screen_rows;           // Terminal height
+    int screen_cols;           // Terminal width
+    char *filename;            // Current filename (NULL if new)
+    int modified;              // 1 if file has unsaved changes
+    Follow *follow;            // Watch on the file if it is followed
+    int insert_mode;           // 1 for insert, 0 for overwrite
+    int show_latency;          // 1 to show key-to-paint times (F12)
+
+    int selecting;             // SEL_* mode, SEL_NONE if no selection
+    int sel_y;                 // Where the selection was started
+    int sel_x;
+    int sel_col;               // Its column, for a block
+    int block_col;             // Cursor column in a block, past line ends
+
+    Caret *carets;             // Cursors besides the main one, in file
+    int caret_count;           // order (Ctrl+L, Ctrl+D)
+    int caret_cap;
+    Jump jump;                 // Go-to still waiting for lines to load
+
+    int view_rows;             // Size of the active pane's text area
+    int view_cols;
+
+    // Redraw bookkeeping: only what changed since the last paint is drawn.
+    int dirty_from;            // First file line to repaint (-1 if none)
+    int dirty_to;              // Last file line to repaint
+    int dirty_all;             // 1 to repaint the whole text area
+    int dirty_menu;            // 1 to repaint the menu bar and borders
+
+    // Notifications replace the status bar, oldest first, until they
+    // expire. Nothing waits for them.
+    Message messages[MESSAGE_QUEUE];
+    int message_head;
+    int message_count;
+    long message_shown;        // When the head went up (ms), 0 if not yet
+
+    int searching;             // 1 while the Find prompt is open
+    int search_fresh;          // 1 until the recalled query is edited
+    int search_hit;            // 1 if the cursor is on a match
+    int search_origin_y;       // Cursor when the prompt opened
+    int search_origin_x;
+    SearchIndex search;        // Last query and its matches
+
+    int replacing;             // 1 while a replace-all job runs
+    long replace_started;      // When it started (ms)
+    ReplaceJob replace;
+
+    Syntax syntax;             // Highlighting rules for the file type
+    ColumnCache columns;       // Display columns of recently used lines
+
+    Tab *tabs;                 // Open files; tabs[tab] is stale while active
+    int tab_count;
+    int tab;                   // Active tab, the one panes[pane] shows
+    Pane *panes;               // Views, tiling rows 1..screen_rows-2
+    int pane_count;
+    int pane;                  // Active pane
+
+    // Yes/no question for the user, NULL (always no) without one.
+    int (*ask)(struct EditorState *ed, const char *question);
+    // Save the file, asking for a name if it has none; NULL leaves it
+    // unsaved.
+    void (*save)(struct EditorState *ed);
+} EditorState;
+
+// GLOBALS
+extern Clipboard clipboard;
+
+// PROTOTYPES
+void editor_init(EditorState *ed, int rows, int cols);
+void editor_free(EditorState *ed);
+void free_tab(Tab *t);
+size_t undo_budget(void);
+long now_ms(void);
+
+void mark_dirty(EditorState *ed, int from, int to);
+void mark_changed(EditorState *ed, int from, int to);
+void mark_all_dirty(EditorState *ed);
+void sync_buffer(EditorState *ed);
+void show_message(EditorState *ed, const char *msg, int duration_ms);
+Message *current_message(EditorState *ed);
+int message_timeout(EditorState *ed);
+
+int write_file(EditorState *ed);
+int open_file(EditorState *ed, const char *filename);
+int follow_file(EditorState *ed, const char *filename);
+void follow_appended(EditorState *ed);
+void recover_journal(EditorState *ed);
+
+// tabs
+void store_tab(EditorState *ed, Tab *t);
+void load_tab(EditorState *ed, Tab *t);
+void add_tab(EditorState *ed, const char *filename);
+void open_tab(EditorState *ed, const char *filename);
+void switch_tab(EditorState *ed, int n);
+const char *tab_filename(EditorState *ed, int i);
+int confirm_save(EditorState *ed);
+int close_tab(EditorState *ed);
+
+void edit_key(EditorState *ed, int ch);
+void type_char(EditorState *ed, const char *ch, int len);
+const char *key_name(int ch);
+int key_code(const char *name);
+void insert_char(EditorState *ed, const char *ch, int len);
+void delete_char_backspace(EditorState *ed);
+void delete_char_forward(EditorState *ed);
+void insert_newline(EditorState *ed);
+void paste_text(EditorState *ed, const char *text, size_t len);
+void edit_insert(EditorState *ed, int y, int x, const char *text, size_t len);
+void edit_delete(EditorState *ed, int y1, int x1, int y2, int x2);
+void undo_edit(EditorState *ed, int redo);
+void copy_line(EditorState *ed);
+void cut_line(EditorState *ed);
+void paste_clipboard(EditorState *ed);
+
+void move_cursor(EditorState *ed, int dy, int dx);
+void move_to_line_start(EditorState *ed);
+void move_to_line_end(EditorState *ed);
+void scroll_if_needed(EditorState *ed);
+int cursor_col(EditorState *ed);
+int gutter_width(EditorState *ed);
+void move_page(EditorState *ed, int dir);
+void jump_to_line(EditorState *ed, int y);
+void jump_to_offset(EditorState *ed, size_t offset);
+void jump_to_start(EditorState *ed);
+void jump_to_end(EditorState *ed);
+int go_to(EditorState *ed, const char *where);
+
+// multiple cursors
+void drop_carets(EditorState *ed);
+void carets_from_selection(EditorState *ed);
+void carets_from_search(EditorState *ed);
+int caret_first(EditorState *ed, int y);
+
+// selection helpers
+void get_selection(EditorState *ed, Selection *sel);
+void start_selection(EditorState *ed, int mode);
+void select_all(EditorState *ed);
+void copy_selection(EditorState *ed);
+void cut_selection(EditorState *ed);
+int delete_selection(EditorState *ed);
+
+#endif
@@ -0,0 +1,83 @@
+/*
+ * LIWIT - Linux-Windows Text Editor
+ * Copyright (C) 2026  Khud Bakhtiyar Iqbal Sofi
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <libgen.h>
+#include <unistd.h>
+#include <sys/inotify.h>
+#include <sys/stat.h>
+#include "follow.h"
+
+// Follow the file open as fd under the name path.
+Follow *follow_start(const char *path, int fd) {
+    struct stat st;
+    if (fstat(fd, &st) != 0) return NULL;
+
+    Follow *f = (Follow *)calloc(1, sizeof(Follow));
+    f->path = strdup(path);
+    f->dev = st.st_dev;
+    f->ino = st.st_ino;
+
+    f->fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (f->fd >= 0) {
+        char *copy = strdup(path);
+        f->file_wd = inotify_add_watch(f->fd, path,
+                                       IN_MODIFY | IN_ATTRIB |
+                                       IN_MOVE_SELF | IN_DELETE_SELF);
+        f->dir_wd = inotify_add_watch(f->fd, dirname(copy),
+                                      IN_CREATE | IN_MOVED_TO);
+        free(copy);
+        if (f->file_wd < 0) {
+            close(f->fd);
+            f->fd = -1;
+        }
+    }
+    return f;
+}
+
+void follow_stop(Follow *f) {
+    if (!f) return;
+    if (f->fd >= 0) close(f->fd);
+    free(f->path);
+    free(f);
+}
+
+// Drain the pending events. Returns 0 if nothing happened to the file,
+// FOLLOW_REPLACED if its name now belongs to another file, and
+// FOLLOW_CHANGED otherwise.
+int follow_poll(Follow *f) {
+    int events = f->fd < 0;
+    char ev[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+    while (f->fd >= 0) {
+        ssize_t n = read(f->fd, ev, sizeof(ev));
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) break;
+        events = 1;
+    }
+    if (!events) return 0;
+
+    // Until the new file shows up, the old one is followed further.
+    struct stat st;
+    if (stat(f->path, &st) == 0 &&
+        (st.st_dev != f->dev || st.st_ino != f->ino)) {
+        return FOLLOW_REPLACED;
+    }
+    return FOLLOW_CHANGED;
+}
@@ -0,0 +1,55 @@
+/*
+ * LIWIT - Linux-Windows Text Editor
+ * Copyright (C) 2026  Khud Bakhtiyar Iqbal Sofi
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Following a file that is still being written.
+ *
+ * inotify reports writes to the file and new files in its directory, so
+ * the editor only looks at the file when something happened to it. A
+ * file that shrank is left to the buffer to notice; one that was
+ * replaced under its name (a rotated log) is reported as such. Without
+ * inotify every poll looks.
+ */
+
+#ifndef LIWIT_FOLLOW_H
+#define LIWIT_FOLLOW_H
+
+#include <sys/types.h>
+
+// CONFIGURATION
+#define FOLLOW_POLL_MS 50          // How often a followed file is looked at
+
+#define FOLLOW_CHANGED 1           // The file may have grown or shrunk
+#define FOLLOW_REPLACED 2          // Another file now has its name
+
+// DATA STRUCTURES
+typedef struct {
+    char *path;
+    dev_t dev;                 // Identity of the file being followed
+    ino_t ino;
+    int fd;                    // inotify instance, -1 if unavailable
+    int file_wd;               // Watch on the file
+    int dir_wd;                // Watch on its directory
+} Follow;
+
+// PROTOTYPES
+Follow *follow_start(const char *path, int fd);
+void follow_stop(Follow *f);
+int follow_poll(Follow *f);
+
+#endif
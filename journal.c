@@ -0,0 +1,309 @@
+/*
+ * LIWIT - Linux-Windows Text Editor
+ * Copyright (C) 2026  Khud Bakhtiyar Iqbal Sofi
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "journal.h"
+
+#define JOURNAL_MAGIC "LIWITJ1\n"
+#define MAGIC_LEN 8
+
+// Journal file name for a file.
+static char *journal_path(const char *file_path) {
+    char *path = (char *)malloc(strlen(file_path) + sizeof(JOURNAL_SUFFIX));
+    strcpy(path, file_path);
+    strcat(path, JOURNAL_SUFFIX);
+    return path;
+}
+
+static void base_of(const char *file_path, JournalBase *base) {
+    struct stat st;
+    memset(base, 0, sizeof(JournalBase));
+    if (stat(file_path, &st) == 0) {
+        base->size = st.st_size;
+        base->mtime_sec = st.st_mtim.tv_sec;
+        base->mtime_nsec = st.st_mtim.tv_nsec;
+        base->inode = st.st_ino;
+    }
+}
+
+static int write_all(int fd, const char *data, size_t len) {
+    while (len > 0) {
+        ssize_t n = write(fd, data, len);
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0) return -1;
+        data += n;
+        len -= n;
+    }
+    return 0;
+}
+
+// WORKER
+// Swap the queue for an empty one and write it out without holding the
+// lock, so recording a change never waits for the disk.
+static void *journal_thread(void *arg) {
+    Journal *j = (Journal *)arg;
+    char *batch = NULL;
+    size_t batch_cap = 0;
+
+    pthread_mutex_lock(&j->lock);
+    for (;;) {
+        if (!j->stop && !j->reset) {
+            struct timespec until;
+            clock_gettime(CLOCK_REALTIME, &until);
+            until.tv_sec += JOURNAL_FLUSH_MS / 1000;
+            until.tv_nsec += (JOURNAL_FLUSH_MS % 1000) * 1000000L;
+            if (until.tv_nsec >= 1000000000L) {
+                until.tv_sec++;
+                until.tv_nsec -= 1000000000L;
+            }
+            pthread_cond_timedwait(&j->wake, &j->lock, &until);
+        }
+
+        int stop = j->stop;
+        int reset = j->reset;
+        JournalBase base = j->base;
+        char *data = j->queue;
+        size_t len = j->queue_len;
+        size_t cap = j->queue_cap;
+        j->queue = batch;
+        j->queue_cap = batch_cap;
+        j->queue_len = 0;
+        j->reset = 0;
+        batch = data;
+        batch_cap = cap;
+        pthread_mutex_unlock(&j->lock);
+
+        if (reset && j->fd >= 0) {
+            close(j->fd);
+            j->fd = -1;
+            unlink(j->path);
+        }
+        if (len > 0 && j->fd < 0) {
+            j->fd = open(j->path, O_WRONLY | O_CREAT | O_TRUNC, 0600);
+            if (j->fd >= 0 &&
+                (write_all(j->fd, JOURNAL_MAGIC, MAGIC_LEN) != 0 ||
+                 write_all(j->fd, (char *)&base, sizeof(base)) != 0)) {
+                close(j->fd);
+                j->fd = -1;
+            }
+        }
+        if (len > 0 && j->fd >= 0) {
+            write_all(j->fd, data, len);
+            fdatasync(j->fd);
+        }
+
+        pthread_mutex_lock(&j->lock);
+        if (stop) break;
+    }
+    pthread_mutex_unlock(&j->lock);
+
+    free(batch);
+    return NULL;
+}
+
+// INITIALIZATION & CLEANUP
+Journal *journal_start(const char *file_path) {
+    Journal *j = (Journal *)calloc(1, sizeof(Journal));
+    j->path = journal_path(file_path);
+    j->fd = -1;
+    base_of(file_path, &j->base);
+    pthread_mutex_init(&j->lock, NULL);
+    pthread_cond_init(&j->wake, NULL);
+
+    if (pthread_create(&j->thread, NULL, journal_thread, j) != 0) {
+        pthread_mutex_destroy(&j->lock);
+        pthread_cond_destroy(&j->wake);
+        free(j->path);
+        free(j);
+        return NULL;
+    }
+    return j;
+}
+
+// Stop the worker. Its journal is removed unless `keep` is set, in which
+// case everything queued is written first.
+void journal_stop(Journal *j, int keep) {
+    if (!j) return;
+
+    pthread_mutex_lock(&j->lock);
+    if (!keep) j->queue_len = 0;
+    j->stop = 1;
+    pthread_cond_signal(&j->wake);
+    pthread_mutex_unlock(&j->lock);
+    pthread_join(j->thread, NULL);
+
+    if (j->fd >= 0) close(j->fd);
+    if (!keep) unlink(j->path);
+
+    pthread_mutex_destroy(&j->lock);
+    pthread_cond_destroy(&j->wake);
+    free(j->queue);
+    free(j->path);
+    free(j);
+}
+
+// The file was just saved: what is queued is in it, and later changes
+// apply to the new contents.
+void journal_reset(Journal *j, const char *file_path) {
+    if (!j) return;
+
+    pthread_mutex_lock(&j->lock);
+    j->queue_len = 0;
+    j->reset = 1;
+    base_of(file_path, &j->base);
+    pthread_cond_signal(&j->wake);
+    pthread_mutex_unlock(&j->lock);
+}
+
+// RECORDING
+static void queue_put(Journal *j, const void *data, size_t len) {
+    if (j->queue_len + len > j->queue_cap) {
+        size_t cap = j->queue_cap ? j->queue_cap * 2 : 4096;
+        while (cap < j->queue_len + len) cap *= 2;
+        j->queue = (char *)realloc(j->queue, cap);
+        j->queue_cap = cap;
+    }
+    memcpy(j->queue + j->queue_len, data, len);
+    j->queue_len += len;
+}
+
+void journal_insert(Journal *j, int y, int x, const char *text, size_t len) {
+    char type = JOURNAL_INSERT;
+    int32_t pos[2] = { y, x };
+    uint64_t n = len;
+
+    pthread_mutex_lock(&j->lock);
+    queue_put(j, &type, 1);
+    queue_put(j, pos, sizeof(pos));
+    queue_put(j, &n, sizeof(n));
+    queue_put(j, text, len);
+    pthread_mutex_unlock(&j->lock);
+}
+
+void journal_delete(Journal *j, int y1, int x1, int y2, int x2) {
+    char type = JOURNAL_DELETE;
+    int32_t pos[4] = { y1, x1, y2, x2 };
+
+    pthread_mutex_lock(&j->lock);
+    queue_put(j, &type, 1);
+    queue_put(j, pos, sizeof(pos));
+    pthread_mutex_unlock(&j->lock);
+}
+
+// RECOVERY
+// Read a journal. Returns its size; -1 if there is none, -2 if it was
+// written against a different version of the file.
+static long journal_load(const char *file_path, char **data) {
+    char *path = journal_path(file_path);
+    int fd = open(path, O_RDONLY);
+    free(path);
+    if (fd < 0) return -1;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 ||
+        st.st_size < (off_t)(MAGIC_LEN + sizeof(JournalBase))) {
+        close(fd);
+        return -1;
+    }
+
+    size_t size = st.st_size;
+    char *buf = (char *)malloc(size);
+    size_t got = 0;
+    while (got < size) {
+        ssize_t n = read(fd, buf + got, size - got);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) break;
+        got += n;
+    }
+    close(fd);
+
+    JournalBase base, now;
+    memcpy(&base, buf + MAGIC_LEN, sizeof(base));
+    base_of(file_path, &now);
+    if (got < size || memcmp(buf, JOURNAL_MAGIC, MAGIC_LEN) != 0) {
+        free(buf);
+        return -1;
+    }
+    if (memcmp(&base, &now, sizeof(base)) != 0) {
+        free(buf);
+        return -2;
+    }
+    *data = buf;
+    return (long)size;
+}
+
+// 1 if a journal with changes for the file exists, -1 if one exists but
+// the file changed since it was written, 0 otherwise.
+int journal_check(const char *file_path) {
+    char *data;
+    long size = journal_load(file_path, &data);
+    if (size == -2) return -1;
+    if (size < 0) return 0;
+    free(data);
+    return size > (long)(MAGIC_LEN + sizeof(JournalBase));
+}
+
+// Feed every complete record to apply(). Returns the number replayed.
+int journal_replay(const char *file_path, JournalApply apply, void *ctx) {
+    char *data;
+    long size = journal_load(file_path, &data);
+    if (size < 0) return 0;
+
+    const char *p = data + MAGIC_LEN + sizeof(JournalBase);
+    const char *end = data + size;
+    int count = 0;
+
+    // A crash can cut the last record short; replay stops there.
+    while (p < end) {
+        char type = *p;
+        if (type == JOURNAL_INSERT) {
+            int32_t pos[2];
+            uint64_t len;
+            if (end - p < 1 + (long)sizeof(pos) + (long)sizeof(len)) break;
+            memcpy(pos, p + 1, sizeof(pos));
+            memcpy(&len, p + 1 + sizeof(pos), sizeof(len));
+            const char *text = p + 1 + sizeof(pos) + sizeof(len);
+            if ((uint64_t)(end - text) < len) break;
+            apply(ctx, type, pos[0], pos[1], 0, 0, text, len);
+            p = text + len;
+        } else if (type == JOURNAL_DELETE) {
+            int32_t pos[4];
+            if (end - p < 1 + (long)sizeof(pos)) break;
+            memcpy(pos, p + 1, sizeof(pos));
+            apply(ctx, type, pos[0], pos[1], pos[2], pos[3], NULL, 0);
+            p += 1 + sizeof(pos);
+        } else {
+            break;
+        }
+        count++;
+    }
+    free(data);
+    return count;
+}
+
+void journal_discard(const char *file_path) {
+    char *path = journal_path(file_path);
+    unlink(path);
+    free(path);
+}
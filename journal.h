@@ -0,0 +1,88 @@
+/*
+ * LIWIT - Linux-Windows Text Editor
+ * Copyright (C) 2026  Khud Bakhtiyar Iqbal Sofi
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Recovery journal.
+ *
+ * Every change made to a file since it was last saved is appended to
+ * "<file>.liwit-journal". Recording a change only copies it into a
+ * queue in memory; a worker thread writes the queue out every
+ * JOURNAL_FLUSH_MS, so typing never waits for the disk.
+ *
+ * The journal starts with the size, mtime and inode of the file it
+ * applies to. It is removed when the file is saved or the editor quits
+ * normally, so one left behind means the editor died with unsaved
+ * changes, which can be replayed on top of the same file.
+ */
+
+#ifndef LIWIT_JOURNAL_H
+#define LIWIT_JOURNAL_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <pthread.h>
+
+// CONFIGURATION
+#define JOURNAL_FLUSH_MS 2000      // How often the worker writes the queue
+#define JOURNAL_SUFFIX ".liwit-journal"
+
+#define JOURNAL_INSERT 'I'
+#define JOURNAL_DELETE 'D'
+
+// DATA STRUCTURES
+typedef struct {
+    uint64_t size;             // Identity of the file the changes apply to
+    int64_t mtime_sec;
+    int64_t mtime_nsec;
+    uint64_t inode;
+} JournalBase;
+
+typedef struct {
+    char *path;                // Journal file
+    int fd;                    // -1 until the first change is written
+
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t wake;
+
+    // Shared with the worker, under lock.
+    char *queue;               // Encoded records not written yet
+    size_t queue_len;
+    size_t queue_cap;
+    JournalBase base;
+    int reset;                 // 1 to drop the file (the text was saved)
+    int stop;
+} Journal;
+
+typedef void (*JournalApply)(void *ctx, int type, int y, int x,
+                             int end_y, int end_x,
+                             const char *text, size_t len);
+
+// PROTOTYPES
+Journal *journal_start(const char *file_path);
+void journal_stop(Journal *j, int keep);
+void journal_reset(Journal *j, const char *file_path);
+
+void journal_insert(Journal *j, int y, int x, const char *text, size_t len);
+void journal_delete(Journal *j, int y1, int x1, int y2, int x2);
+
+int journal_check(const char *file_path);
+int journal_replay(const char *file_path, JournalApply apply, void *ctx);
+void journal_discard(const char *file_path);
+
+#endif
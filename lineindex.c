@@ -0,0 +1,359 @@
+/*
+ * LIWIT - Linux-Windows Text Editor
+ * Copyright (C) 2026  Khud Bakhtiyar Iqbal Sofi
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "lineindex.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define HAVE_X86_SIMD 1
+#endif
+
+#define END_CR32 0x80000000u
+#define END_CR64 0x8000000000000000ull
+
+// OFFSET STORAGE
+// Switch a chunk to 64-bit ends once a line lands 2 GB past its base.
+// The lines already published stay readable through the old array, so
+// it is only let go with the rest of the index.
+static void chunk_widen(IndexChunk *chunk, int used) {
+    uint64_t *wide = (uint64_t *)malloc(INDEX_CHUNK_LINES * sizeof(uint64_t));
+    for (int j = 0; j < used; j++) {
+        uint32_t e = chunk->ends[j];
+        wide[j] = (chunk->base + (e & ~END_CR32)) |
+                  ((e & END_CR32) ? END_CR64 : 0);
+    }
+    atomic_store_explicit(&chunk->wide, wide, memory_order_release);
+}
+
+static inline void index_append(LineIndex *idx, size_t end, int cr) {
+    unsigned int n = idx->scan_count;
+    IndexChunk *chunk = &idx->chunks[n / INDEX_CHUNK_LINES];
+    unsigned int j = n % INDEX_CHUNK_LINES;
+
+    if (__builtin_expect(j == 0, 0)) {
+        chunk->base = idx->line_start;
+        chunk->ends = (uint32_t *)malloc(INDEX_CHUNK_LINES * sizeof(uint32_t));
+    }
+
+    size_t rel = end - chunk->base;
+    uint64_t *wide = atomic_load_explicit(&chunk->wide, memory_order_relaxed);
+    if (__builtin_expect(rel >= END_CR32, 0) && !wide) {
+        chunk_widen(chunk, j);
+        wide = atomic_load_explicit(&chunk->wide, memory_order_relaxed);
+    }
+
+    if (__builtin_expect(wide != NULL, 0)) {
+        wide[j] = end | (cr ? END_CR64 : 0);
+    } else {
+        chunk->ends[j] = (uint32_t)rel | (cr ? END_CR32 : 0);
+    }
+    idx->scan_count++;
+    idx->line_start = end + 1;
+}
+
+// End offset of a line (its '\n' or EOF); *cr is set for "\r\n".
+static size_t index_end(LineIndex *idx, int line, int *cr) {
+    IndexChunk *chunk = &idx->chunks[line / INDEX_CHUNK_LINES];
+    int j = line % INDEX_CHUNK_LINES;
+
+    uint64_t *wide = atomic_load_explicit(&chunk->wide, memory_order_acquire);
+    if (wide) {
+        *cr = (wide[j] & END_CR64) != 0;
+        return wide[j] & ~END_CR64;
+    }
+    *cr = (chunk->ends[j] & END_CR32) != 0;
+    return chunk->base + (chunk->ends[j] & ~END_CR32);
+}
+
+// SCANNERS
+// Each scanner reports every '\n' in [from, to) to index_append().
+static void scan_memchr(LineIndex *idx, size_t from, size_t to) {
+    const char *data = idx->data;
+    const char *p = data + from;
+    const char *stop = data + to;
+
+    while (p < stop) {
+        const char *nl = memchr(p, '\n', stop - p);
+        if (!nl) break;
+        index_append(idx, nl - data, nl > data && nl[-1] == '\r');
+        p = nl + 1;
+    }
+}
+
+#ifdef HAVE_X86_SIMD
+// Walk the newline bits of one 64-byte block. A CR bit shifted up by one
+// lands on the LF it precedes; bit 0 looks back into the previous block.
+static inline void emit_block(LineIndex *idx, size_t base,
+                              uint64_t lf, uint64_t cr) {
+    uint64_t carry = base > 0 && idx->data[base - 1] == '\r';
+    uint64_t crlf = lf & ((cr << 1) | carry);
+
+    while (lf) {
+        int bit = __builtin_ctzll(lf);
+        index_append(idx, base + bit, (crlf >> bit) & 1);
+        lf &= lf - 1;
+    }
+}
+
+static inline uint64_t mask16(__m128i v, __m128i c, int shift) {
+    return (uint64_t)(uint16_t)_mm_movemask_epi8(_mm_cmpeq_epi8(v, c)) << shift;
+}
+
+static void scan_sse2(LineIndex *idx, size_t from, size_t to) {
+    const __m128i nl = _mm_set1_epi8('\n');
+    const __m128i cr = _mm_set1_epi8('\r');
+    size_t pos = from;
+
+    for (; pos + 64 <= to; pos += 64) {
+        const __m128i *p = (const __m128i *)(idx->data + pos);
+        __m128i a = _mm_loadu_si128(p);
+        __m128i b = _mm_loadu_si128(p + 1);
+        __m128i c = _mm_loadu_si128(p + 2);
+        __m128i d = _mm_loadu_si128(p + 3);
+
+        uint64_t lf = mask16(a, nl, 0) | mask16(b, nl, 16) |
+                      mask16(c, nl, 32) | mask16(d, nl, 48);
+        if (!lf) continue;
+
+        uint64_t crm = mask16(a, cr, 0) | mask16(b, cr, 16) |
+                       mask16(c, cr, 32) | mask16(d, cr, 48);
+        emit_block(idx, pos, lf, crm);
+    }
+    scan_memchr(idx, pos, to);
+}
+
+__attribute__((target("avx2")))
+static inline uint64_t mask32(__m256i v, __m256i c, int shift) {
+    return (uint64_t)(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, c))
+           << shift;
+}
+
+__attribute__((target("avx2")))
+static void scan_avx2(LineIndex *idx, size_t from, size_t to) {
+    const __m256i nl = _mm256_set1_epi8('\n');
+    const __m256i cr = _mm256_set1_epi8('\r');
+    size_t pos = from;
+
+    for (; pos + 64 <= to; pos += 64) {
+        const __m256i *p = (const __m256i *)(idx->data + pos);
+        __m256i a = _mm256_loadu_si256(p);
+        __m256i b = _mm256_loadu_si256(p + 1);
+
+        uint64_t lf = mask32(a, nl, 0) | mask32(b, nl, 32);
+        if (!lf) continue;
+
+        uint64_t crm = mask32(a, cr, 0) | mask32(b, cr, 32);
+        emit_block(idx, pos, lf, crm);
+    }
+    scan_memchr(idx, pos, to);
+}
+#endif
+
+typedef struct {
+    const char *name;
+    void (*scan)(LineIndex *idx, size_t from, size_t to);
+} Scanner;
+
+static const Scanner scanners[] = {
+#ifdef HAVE_X86_SIMD
+    { "avx2", scan_avx2 },
+    { "sse2", scan_sse2 },
+#endif
+    { "memchr", scan_memchr },
+};
+
+static const Scanner *scanner;
+
+static int scanner_supported(const Scanner *s) {
+#ifdef HAVE_X86_SIMD
+    if (s->scan == scan_avx2) return __builtin_cpu_supports("avx2");
+    if (s->scan == scan_sse2) return __builtin_cpu_supports("sse2");
+#endif
+    (void)s;
+    return 1;
+}
+
+static const Scanner *scanner_pick(void) {
+    if (!scanner) {
+        int n = sizeof(scanners) / sizeof(scanners[0]);
+        for (int i = 0; i < n && !scanner; i++) {
+            if (scanner_supported(&scanners[i])) scanner = &scanners[i];
+        }
+    }
+    return scanner;
+}
+
+const char *lineindex_scanner(void) {
+    return scanner_pick()->name;
+}
+
+// Force a scanner by name (for benchmarks). Returns -1 if unavailable.
+int lineindex_use_scanner(const char *name) {
+    int n = sizeof(scanners) / sizeof(scanners[0]);
+    for (int i = 0; i < n; i++) {
+        if (strcmp(scanners[i].name, name) == 0 &&
+            scanner_supported(&scanners[i])) {
+            scanner = &scanners[i];
+            return 0;
+        }
+    }
+    return -1;
+}
+
+// Index the image up to byte `limit` and publish the lines found.
+static void index_scan(LineIndex *idx, size_t limit) {
+    if (limit > idx->size) limit = idx->size;
+
+    scanner_pick()->scan(idx, idx->scan_pos, limit);
+    idx->scan_pos = limit;
+
+    int finished = limit == idx->size;
+    if (finished && idx->line_start < idx->size) {
+        index_append(idx, idx->size, 0);  // last line has no '\n'
+    }
+
+    atomic_store_explicit(&idx->count, idx->scan_count, memory_order_release);
+    if (finished) atomic_store_explicit(&idx->done, 1, memory_order_release);
+}
+
+static void *index_thread(void *arg) {
+    LineIndex *idx = (LineIndex *)arg;
+    while (!atomic_load(&idx->stop) && !atomic_load(&idx->done)) {
+        index_scan(idx, idx->scan_pos + INDEX_PUBLISH_BYTES);
+    }
+    return NULL;
+}
+
+// INITIALIZATION & CLEANUP
+// The first lines are indexed right away so the caller can draw the
+// first screen; the rest is left to a thread when `background` is set.
+LineIndex *lineindex_create(const char *data, size_t size, int background) {
+    LineIndex *idx = (LineIndex *)calloc(1, sizeof(LineIndex));
+    idx->data = data;
+    idx->size = size;
+    idx->chunk_slots = size / INDEX_CHUNK_LINES + 2;
+    idx->chunks = (IndexChunk *)calloc(idx->chunk_slots, sizeof(IndexChunk));
+    atomic_init(&idx->count, 0);
+    atomic_init(&idx->done, 0);
+    atomic_init(&idx->stop, 0);
+
+    size_t first = background ? INDEX_PUBLISH_BYTES / 16 : size;
+    do {
+        index_scan(idx, idx->scan_pos + first);
+    } while (idx->scan_count == 0 && !atomic_load(&idx->done));
+
+    // The first line decides the line ending style of the whole file.
+    if (idx->scan_count > 0) index_end(idx, 0, &idx->crlf);
+
+    if (!atomic_load(&idx->done)) {
+        idx->threaded =
+            pthread_create(&idx->thread, NULL, index_thread, idx) == 0;
+        if (!idx->threaded) index_scan(idx, size);
+    }
+    return idx;
+}
+
+void lineindex_wait(LineIndex *idx) {
+    if (idx->threaded) {
+        pthread_join(idx->thread, NULL);
+        idx->threaded = 0;
+    }
+}
+
+void lineindex_free(LineIndex *idx) {
+    if (!idx) return;
+    atomic_store(&idx->stop, 1);
+    lineindex_wait(idx);
+    for (size_t i = 0; i < idx->chunk_slots; i++) {
+        free(idx->chunks[i].ends);
+        free(idx->chunks[i].wide);
+    }
+    free(idx->chunks);
+    free(idx);
+}
+
+// Index bytes appended to the image, which now runs to `size` and must
+// not have moved. An unterminated last line is taken back and scanned
+// again along with what follows it. Returns 1 if that happened, as the
+// line's text changed. The caller has already waited for the thread.
+int lineindex_extend(LineIndex *idx, size_t size) {
+    size_t slots = size / INDEX_CHUNK_LINES + 2;
+    if (slots > idx->chunk_slots) {
+        idx->chunks = (IndexChunk *)realloc(idx->chunks,
+                                            slots * sizeof(IndexChunk));
+        memset(&idx->chunks[idx->chunk_slots], 0,
+               (slots - idx->chunk_slots) * sizeof(IndexChunk));
+        idx->chunk_slots = slots;
+    }
+
+    int reopened = idx->scan_count > 0 && idx->line_start > idx->size;
+    if (reopened) {
+        int n = --idx->scan_count;
+        IndexChunk *chunk = &idx->chunks[n / INDEX_CHUNK_LINES];
+        if (n % INDEX_CHUNK_LINES == 0) {
+            free(chunk->ends);
+            free(chunk->wide);
+            chunk->ends = NULL;
+            chunk->wide = NULL;
+        }
+        int cr;
+        idx->line_start = n > 0 ? index_end(idx, n - 1, &cr) + 1 : 0;
+    }
+
+    int first = idx->scan_count == 0;
+    idx->size = size;
+    atomic_store(&idx->done, 0);
+    index_scan(idx, size);
+    if (first && idx->scan_count > 0) index_end(idx, 0, &idx->crlf);
+    return reopened;
+}
+
+// ACCESS
+int lineindex_count(LineIndex *idx) {
+    return atomic_load_explicit(&idx->count, memory_order_acquire);
+}
+
+int lineindex_done(LineIndex *idx) {
+    return atomic_load_explicit(&idx->done, memory_order_acquire);
+}
+
+// Byte range of a published line, without its line ending.
+void lineindex_span(LineIndex *idx, int line, size_t *start, size_t *end) {
+    int cr;
+    *end = index_end(idx, line, &cr);
+    if (cr && idx->crlf) (*end)--;
+
+    *start = (line == 0) ? 0 : index_end(idx, line - 1, &cr) + 1;
+}
+
+// Line holding byte `offset` of the image, its line ending included, by
+// binary search over the published lines. Returns lineindex_count() if
+// the offset lies past them.
+int lineindex_line_at(LineIndex *idx, size_t offset) {
+    int lo = 0;
+    int hi = lineindex_count(idx);
+    int cr;
+    while (lo < hi) {
+        int mid = lo + (hi - lo) / 2;
+        if (index_end(idx, mid, &cr) < offset) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo;
+}
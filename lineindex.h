@@ -0,0 +1,91 @@
+/*
+ * LIWIT - Linux-Windows Text Editor
+ * Copyright (C) 2026  Khud Bakhtiyar Iqbal Sofi
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Line index.
+ *
+ * Records where every line of a file image ends. Large files are
+ * indexed by a background thread: lines are published in batches and
+ * the editor picks them up with lineindex_count() while the user is
+ * already looking at the first screen. An image that grows in place (a
+ * file still being written) is indexed further as bytes are appended.
+ *
+ * The scanner looks for '\n' and '\r' 64 bytes at a time (AVX2 or SSE2,
+ * picked at run time, with a memchr fallback). Line ends are stored as
+ * 32-bit offsets from the start of their chunk, with the top bit marking
+ * a "\r\n" ending.
+ */
+
+#ifndef LIWIT_LINEINDEX_H
+#define LIWIT_LINEINDEX_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <stdatomic.h>
+
+// CONFIGURATION
+#define INDEX_CHUNK_LINES 65536        // Line offsets per chunk
+#define INDEX_PUBLISH_BYTES (1 << 20)  // Publish progress every 1 MB scanned
+
+// DATA STRUCTURES
+typedef struct {
+    size_t base;               // Offset of the chunk's first line
+    uint32_t *ends;            // Line ends relative to base, top bit = CRLF
+    // Replaces ends if the chunk spans >= 2 GB. ends is kept until the
+    // index is freed, as the editor may still be reading through it.
+    _Atomic(uint64_t *) wide;
+} IndexChunk;
+
+typedef struct {
+    const char *data;          // File image being indexed
+    size_t size;
+    int crlf;                  // 1 if the file uses "\r\n" line endings
+
+    // Preallocated so the directory never moves while the thread appends.
+    IndexChunk *chunks;        // Line i lives in chunks[i / INDEX_CHUNK_LINES]
+    size_t chunk_slots;
+
+    atomic_int count;          // Lines published so far
+    atomic_int done;           // 1 once the whole image is indexed
+    atomic_int stop;           // Asks the thread to give up early
+
+    int threaded;
+    pthread_t thread;
+
+    // Scanner state, owned by whoever is currently indexing.
+    size_t scan_pos;
+    size_t line_start;         // Start of the line being scanned
+    int scan_count;
+} LineIndex;
+
+// PROTOTYPES
+LineIndex *lineindex_create(const char *data, size_t size, int background);
+void lineindex_free(LineIndex *idx);
+void lineindex_wait(LineIndex *idx);
+int lineindex_extend(LineIndex *idx, size_t size);
+
+int lineindex_count(LineIndex *idx);
+int lineindex_done(LineIndex *idx);
+void lineindex_span(LineIndex *idx, int line, size_t *start, size_t *end);
+int lineindex_line_at(LineIndex *idx, size_t offset);
+
+const char *lineindex_scanner(void);
+int lineindex_use_scanner(const char *name);
+
+#endif
@@ -16,79 +16,136 @@
  * along with this program.  If not, see <https://www.gnu.org/licenses/>.
  */
 
+#define NCURSES_WIDECHAR 1     // Wide-character API of ncursesw
 #include <ncurses.h>
+#include <locale.h>
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
+#include <time.h>
+#include "editor.h"
 
 // CONFIGURATION
 #define VERSION "1.0"
-#define MAX_LINES 5000
-#define MAX_LINE_LENGTH 1024
-#define TAB_SIZE 4
+#define LOAD_POLL_MS 100       // Redraw interval while a file is indexed
+#define PASTE_TIMEOUT_MS 500   // Give up on a paste whose end marker is lost
+#define ESC_DELAY_MS 100       // Wait for the rest of an escape sequence
+#define REPLACE_POLL_MS 20     // Progress redraw interval of a replace-all
+#define TAB_LABEL_COLS 24      // Longest file name shown on a tab
+#define PANE_MIN_ROWS 3        // Smallest pane a split may leave
+#define PANE_MIN_COLS 12
+
+// Key codes for the bracketed paste markers (ESC[200~ / ESC[201~)
+#define KEY_PASTE_BEGIN (KEY_MAX + 1)
+#define KEY_PASTE_END (KEY_MAX + 2)
+
+// Key codes for Ctrl+PgDn / Ctrl+PgUp and Ctrl+Tab / Ctrl+Shift+Tab
+#define KEY_TAB_NEXT (KEY_MAX + 3)
+#define KEY_TAB_PREV (KEY_MAX + 4)
+
+// Key codes for Alt+Shift+arrows, and for Ctrl+Home and Ctrl+End, which
+// terminfo has no names for
+#define KEY_BLOCK_UP (KEY_MAX + 5)
+#define KEY_BLOCK_DOWN (KEY_MAX + 6)
+#define KEY_BLOCK_LEFT (KEY_MAX + 7)
+#define KEY_BLOCK_RIGHT (KEY_MAX + 8)
+#define KEY_FILE_START (KEY_MAX + 9)
+#define KEY_FILE_END (KEY_MAX + 10)
 
 // DATA STRUCTURES
+// A pane's window and what was last painted in it, so only what changed
+// is painted again.
 typedef struct {
-    char **lines;              // Array of text lines
-    int line_count;            // Number of lines in file
-    int cursor_x;              // Cursor column position (0-based)
-    int cursor_y;              // Cursor row position (0-based)
-    int offset_x;              // Horizontal scroll offset
-    int offset_y;              // Vertical scroll offset
-    int screen_rows;           // Terminal height
-    int screen_cols;           // Terminal width
-    char *filename;            // Current filename (NULL if new)
-    int modified;              // 1 if file has unsaved changes
-    int insert_mode;           // 1 for insert, 0 for overwrite
-
-    int selecting;             // 1 if selection active
-    int sel_start_y;           // selection start line
-    int sel_end_y;             // selection end line
-} EditorState;
+    WINDOW *win;
+    int drawn_offset_x;        // Viewport at the last paint
+    int drawn_offset_y;
+    int drawn_gutter;          // Gutter width at the last paint
+    Selection drawn_sel;       // Selection at the last paint
+    int *drawn_states;         // Lexer state each text row was drawn in
+} PaneView;
+
+typedef struct {
+    PaneView *panes;           // One for each of ed->panes, in its order
+    char *drawn_status;        // Status bar text at the last paint
+    int drawn_modified;        // Modified flag on the menu bar's tab
+} Screen;
 
 // GLOBALS
-char *clipboard = NULL;
+FILE *recording = NULL;        // Keystroke script being written, if any
+static Screen screen;
 
 // PROTOTYPES
 void init_editor(EditorState *ed);
 void cleanup_editor(EditorState *ed);
 void draw_screen(EditorState *ed);
 void handle_input(EditorState *ed);
+void process_key(EditorState *ed, int ch);
+void read_paste(EditorState *ed);
+void set_bracketed_paste(int on);
+void define_tab_keys(void);
+void define_block_keys(void);
+void define_jump_keys(void);
+void record_key(int ch);
+void record_text(const char *prefix, const char *text, size_t len);
 
 void draw_menu_bar(EditorState *ed);
+void draw_borders(EditorState *ed);
 void draw_status_bar(EditorState *ed);
 void draw_text_area(EditorState *ed);
-void show_message(EditorState *ed, const char *msg, int duration_ms);
+void draw_text_row(EditorState *ed, int screen_row, const Selection *sel,
+                   int state);
+void mark_status_dirty(EditorState *ed);
+void toggle_latency(EditorState *ed);
+void resize_editor(EditorState *ed);
 
+int ask_user(EditorState *ed, const char *question);
 void save_file(EditorState *ed);
-void open_file(EditorState *ed, const char *filename);
-
-void insert_char(EditorState *ed, char ch);
-void delete_char_backspace(EditorState *ed);
-void insert_newline(EditorState *ed);
-void copy_line(EditorState *ed);
-void cut_line(EditorState *ed);
-void paste_clipboard(EditorState *ed);
-
-void move_cursor(EditorState *ed, int dy, int dx);
-void move_to_line_start(EditorState *ed);
-void move_to_line_end(EditorState *ed);
-void scroll_if_needed(EditorState *ed);
-
-// selection helpers
-void get_selection_range(EditorState *ed, int *start, int *end);
-void copy_selection(EditorState *ed);
-void cut_selection(EditorState *ed);
-void delete_selection(EditorState *ed);
+int following(EditorState *ed);
+
+// tabs
+void quit_editor(EditorState *ed);
+void exit_editor(EditorState *ed);
+void trim_tabs(EditorState *ed);
+
+// panes
+void use_pane(EditorState *ed, int n);
+void layout_panes(EditorState *ed);
+void split_pane(EditorState *ed, int side_by_side);
+void focus_pane(EditorState *ed, int n);
+void close_pane(EditorState *ed);
+
+// go to
+void go_to_prompt(EditorState *ed);
+
+// search
+void start_search(EditorState *ed);
+void search_key(EditorState *ed, int ch);
+void search_update(EditorState *ed);
+void search_jump(EditorState *ed, int dir);
+
+// replace
+void start_replace(EditorState *ed);
+void replace_poll(EditorState *ed);
+
+// The view of the pane EditorState works on.
+static PaneView *view(EditorState *ed) {
+    return &screen.panes[ed->pane];
+}
 
 // MAIN
 int main(int argc, char *argv[]) {
     EditorState editor;
 
+    setlocale(LC_ALL, "");
     initscr();
     raw();
     noecho();
     keypad(stdscr, TRUE);
+    set_escdelay(ESC_DELAY_MS);
+    set_bracketed_paste(1);
+    define_tab_keys();
+    define_block_keys();
+    define_jump_keys();
 
     if (has_colors()) {
         start_color();
@@ -97,170 +154,619 @@ int main(int argc, char *argv[]) {
         init_pair(3, COLOR_YELLOW, COLOR_BLACK);  // Line numbers
         init_pair(4, COLOR_GREEN, COLOR_BLACK);   // Success messages
         init_pair(5, COLOR_RED, COLOR_BLACK);     // Error messages
+        init_pair(6, COLOR_BLACK, COLOR_YELLOW);  // Search matches
+        init_pair(7, COLOR_CYAN, COLOR_BLACK);    // Comments
+        init_pair(8, COLOR_YELLOW, COLOR_BLACK);  // Keywords
+        init_pair(9, COLOR_GREEN, COLOR_BLACK);   // Types
+        init_pair(10, COLOR_MAGENTA, COLOR_BLACK);  // Strings
+        init_pair(11, COLOR_RED, COLOR_BLACK);    // Numbers
+        init_pair(12, COLOR_BLUE, COLOR_BLACK);   // Preprocessor
+        init_pair(13, COLOR_GREEN, COLOR_BLACK);  // Keys
+        init_pair(14, COLOR_YELLOW, COLOR_BLACK);  // Sections
+        init_pair(15, COLOR_CYAN, COLOR_BLACK);   // Variables
     }
 
     init_editor(&editor);
 
-    if (argc > 1) {
-        open_file(&editor, argv[1]);
+    // -f follows the files as they grow. Further files get tabs of their
+    // own, opened when first shown.
+    int follow = argc > 1 && strcmp(argv[1], "-f") == 0;
+    int first = 1 + follow;
+    if (argc > first) {
+        if (follow) follow_file(&editor, argv[first]);
+        else open_file(&editor, argv[first]);
+    }
+    for (int i = first + 1; i < argc; i++) {
+        add_tab(&editor, argv[i]);
+        editor.tabs[editor.tab_count - 1].pending_follow = follow;
     }
 
     while (1) {
+        sync_buffer(&editor);
+        // The last query's matches go on being indexed after the prompt
+        // closes, so F3 and Shift+F3 stay binary searches.
+        int indexing = search_step(&editor.search, &editor.buf,
+                                   SEARCH_SLICE_BYTES);
+        replace_poll(&editor);
+        trim_tabs(&editor);
         draw_screen(&editor);
+
+        // Wake up for the next expiring message or indexing progress;
+        // don't wait at all while matches are still being indexed.
+        int timeout = message_timeout(&editor);
+        if (buffer_loading(&editor.buf) &&
+            (timeout < 0 || timeout > LOAD_POLL_MS)) {
+            timeout = LOAD_POLL_MS;
+        }
+        if (editor.replacing && (timeout < 0 || timeout > REPLACE_POLL_MS)) {
+            timeout = REPLACE_POLL_MS;
+        }
+        if (following(&editor) &&
+            (timeout < 0 || timeout > FOLLOW_POLL_MS)) {
+            timeout = FOLLOW_POLL_MS;
+        }
+        if (indexing || buffer_growing(&editor.buf)) timeout = 0;
+        wtimeout(view(&editor)->win, timeout);
         handle_input(&editor);
     }
 
     cleanup_editor(&editor);
+    set_bracketed_paste(0);
     endwin();
     return 0;
 }
 
 // INITIALIZATION & CLEANUP
 void init_editor(EditorState *ed) {
-    ed->lines = (char **)malloc(MAX_LINES * sizeof(char *));
-    ed->lines[0] = (char *)calloc(MAX_LINE_LENGTH, sizeof(char));
-
-    ed->line_count = 1;
-    ed->cursor_x = 0;
-    ed->cursor_y = 0;
-    ed->offset_x = 0;
-    ed->offset_y = 0;
-    ed->filename = NULL;
-    ed->modified = 0;
-    ed->insert_mode = 1;
-
-    ed->selecting = 0;
-    ed->sel_start_y = 0;
-    ed->sel_end_y = 0;
+    int rows, cols;
+    getmaxyx(stdscr, rows, cols);
+    editor_init(ed, rows, cols);
+    ed->ask = ask_user;
+    ed->save = save_file;
+    screen.panes = (PaneView *)calloc(1, sizeof(PaneView));
+    screen.drawn_status = (char *)calloc(cols + 1, 1);
+
+    // LIWIT_TRACE=file.json writes a Chrome trace of the session on exit.
+    const char *trace = getenv("LIWIT_TRACE");
+    if (trace) trace_start(trace);
+
+    const char *record = getenv("LIWIT_RECORD");
+    if (record && (recording = fopen(record, "w"))) {
+        setvbuf(recording, NULL, _IOLBF, 0);
+    }
+
+    // One pane over the whole text area; layout_panes() makes its window.
+    layout_panes(ed);
+}
 
+// Panes keep their share of the screen: every border moves in proportion.
+void resize_editor(EditorState *ed) {
+    int old_rows = ed->screen_rows > 3 ? ed->screen_rows - 2 : 1;
+    int old_cols = ed->screen_cols > 0 ? ed->screen_cols : 1;
     getmaxyx(stdscr, ed->screen_rows, ed->screen_cols);
+    int rows = ed->screen_rows - 2;
+    int cols = ed->screen_cols;
+
+    for (int i = 0; i < ed->pane_count; i++) {
+        Pane *p = &ed->panes[i];
+        int bottom = 1 + (p->top + p->height - 1) * rows / old_rows;
+        int right = (p->left + p->width) * cols / old_cols;
+        p->top = 1 + (p->top - 1) * rows / old_rows;
+        p->left = p->left * cols / old_cols;
+        p->height = bottom - p->top;
+        p->width = right - p->left;
+    }
+    layout_panes(ed);
+
+    free(screen.drawn_status);
+    screen.drawn_status = (char *)calloc(ed->screen_cols + 1, 1);
+    scroll_if_needed(ed);
 }
 
 void cleanup_editor(EditorState *ed) {
-    for (int i = 0; i < ed->line_count; i++) {
-        free(ed->lines[i]);
+    for (int i = 0; i < ed->pane_count; i++) {
+        delwin(screen.panes[i].win);
+        free(screen.panes[i].drawn_states);
     }
-    free(ed->lines);
-    if (ed->filename) free(ed->filename);
-    if (clipboard) free(clipboard);
+    free(screen.panes);
+    free(screen.drawn_status);
+    editor_free(ed);
+    if (recording) fclose(recording);
+    trace_stop();
 }
 
 // DISPLAY
+// Repaint only what changed. Screen output is batched with
+// wnoutrefresh() and sent once by doupdate(); the text window goes last
+// so the terminal cursor ends up at the editing position.
 void draw_screen(EditorState *ed) {
-    clear();
-    draw_menu_bar(ed);
-    draw_text_area(ed);
+    long t0 = trace_begin();
+    if (ed->dirty_menu || screen.drawn_modified != ed->modified) {
+        draw_menu_bar(ed);
+        draw_borders(ed);
+    }
     draw_status_bar(ed);
-    move(ed->cursor_y - ed->offset_y + 1,
-         ed->cursor_x - ed->offset_x + 5);
-    refresh();
+    wnoutrefresh(stdscr);
+
+    // The other panes are brought in one at a time to be drawn.
+    int active = ed->pane;
+    for (int i = 0; i < ed->pane_count; i++) {
+        if (i == active) continue;
+        // The replace workers read ed->buf, which bringing in another tab
+        // would overwrite. Those panes wait until the job is done; their
+        // text cannot change before then.
+        if (ed->replacing && ed->panes[i].tab != ed->tab) continue;
+        use_pane(ed, i);
+        sync_buffer(ed);
+        draw_text_area(ed);
+        wnoutrefresh(view(ed)->win);
+    }
+    use_pane(ed, active);
+
+    draw_text_area(ed);
+    wmove(view(ed)->win, ed->cursor_y - ed->offset_y,
+          cursor_col(ed) - ed->offset_x + gutter_width(ed));
+    wnoutrefresh(view(ed)->win);
+
+    // Leave the terminal cursor in the Find prompt while it is open.
+    if (ed->searching) {
+        move(ed->screen_rows - 1,
+             7 + utf8_width(ed->search.query, (int)ed->search.len));
+        wnoutrefresh(stdscr);
+    }
+    trace_end(TRACE_DRAW, t0);
+
+    t0 = trace_begin();
+    doupdate();
+    trace_end(TRACE_REFRESH, t0);
+    trace_painted();
+}
+
+// The status row was overwritten by a message or prompt.
+void mark_status_dirty(EditorState *ed) {
+    screen.drawn_status[0] = '\0';
+}
+
+// F12: key-to-paint times on the status bar. They are only taken while
+// shown, or while a trace file is written.
+void toggle_latency(EditorState *ed) {
+    ed->show_latency = !ed->show_latency;
+    if (ed->show_latency) trace_start(NULL);
+    else trace_pause();
+}
+
+// " name+ " for tab i, with the name clipped to TAB_LABEL_COLS columns.
+// Returns the width of the label.
+static int tab_label(EditorState *ed, int i, char *label, size_t size) {
+    const char *path = tab_filename(ed, i);
+    const char *name = path ? strrchr(path, '/') : NULL;
+    name = name ? name + 1 : path ? path : "[New File]";
+    int modified = i == ed->tab ? ed->modified : ed->tabs[i].modified;
+
+    int len = (int)strlen(name);
+    while (utf8_width(name, len) > TAB_LABEL_COLS) len = utf8_prev(name, len);
+    snprintf(label, size, " %.*s%s ", len, name, modified ? "+" : "");
+    return utf8_width(label, (int)strlen(label));
+}
+
+// Tabs along the menu bar from column x, scrolled so the active one shows.
+static void draw_tabs(EditorState *ed, int x) {
+    char label[TAB_LABEL_COLS * 4 + 8];
+    int width = tab_label(ed, ed->tab, label, sizeof(label));
+    int first = ed->tab;
+    while (first > 0) {
+        int w = tab_label(ed, first - 1, label, sizeof(label));
+        if (x + width + w > ed->screen_cols) break;
+        width += w;
+        first--;
+    }
+
+    attr_t active = has_colors() ? A_REVERSE : A_BOLD;
+    for (int i = first; i < ed->tab_count; i++) {
+        int w = tab_label(ed, i, label, sizeof(label));
+        if (x + w > ed->screen_cols) break;
+        if (i == ed->tab) attron(active);
+        mvaddstr(0, x, label);
+        if (i == ed->tab) attroff(active);
+        x += w;
+    }
 }
 
+// Key hints, or the tabs once more than one file is open.
 void draw_menu_bar(EditorState *ed) {
     if (has_colors()) attron(COLOR_PAIR(1));
     else attron(A_REVERSE);
 
-    mvprintw(0, 0, " LIWIT v%s ", VERSION);
-    mvprintw(0, 15, " Ctrl+S:Save ");
-    mvprintw(0, 30, " Ctrl+O:Open ");
-    mvprintw(0, 45, " Ctrl+Q:Quit ");
-//    mvprintw(0, 72, " F1:Help ");
-    mvprintw(0, 60, " F2:Select ");
+    move(0, 0);
+    for (int i = 0; i < ed->screen_cols; i++) addch(' ');
 
-    for (int i = 82; i < ed->screen_cols; i++) addch(' ');
+    mvprintw(0, 0, " LIWIT v%s ", VERSION);
+    if (ed->tab_count > 1) {
+        draw_tabs(ed, 13);
+    } else {
+        mvprintw(0, 15, " Ctrl+S:Save ");
+        mvprintw(0, 30, " Ctrl+O:Open ");
+        mvprintw(0, 45, " Ctrl+Q:Quit ");
+//        mvprintw(0, 72, " F1:Help ");
+        mvprintw(0, 60, " F2:Select ");
+    }
 
     if (has_colors()) attroff(COLOR_PAIR(1));
     else attroff(A_REVERSE);
+
+    ed->dirty_menu = 0;
+    screen.drawn_modified = ed->modified;
 }
 
-void get_selection_range(EditorState *ed, int *start, int *end) {
-    if (!ed->selecting) {
-        *start = *end = -1;
-        return;
+// Lines between the panes. A border below a pane carries the name of the
+// file it shows, in bold for the active pane.
+void draw_borders(EditorState *ed) {
+    char label[TAB_LABEL_COLS * 4 + 8];
+    for (int i = 0; i < ed->pane_count; i++) {
+        Pane *p = &ed->panes[i];
+        int right = p->left + p->width < ed->screen_cols;
+        if (right) {
+            mvvline(p->top, p->left + p->width - 1, ACS_VLINE, p->height);
+        }
+        if (p->top + p->height >= ed->screen_rows - 1) continue;
+
+        int row = p->top + p->height - 1;
+        int width = p->width - right;
+        mvhline(row, p->left, ACS_HLINE, width);
+        if (tab_label(ed, p->tab, label, sizeof(label)) < width) {
+            if (i == ed->pane) attron(A_BOLD);
+            mvaddstr(row, p->left + 1, label);
+            if (i == ed->pane) attroff(A_BOLD);
+        }
     }
-    int s = ed->sel_start_y;
-    int e = ed->sel_end_y;
-    if (s > e) { int tmp = s; s = e; e = tmp; }
-    if (s < 0) s = 0;
-    if (e >= ed->line_count) e = ed->line_count - 1;
-    *start = s;
-    *end = e;
 }
 
 void draw_text_area(EditorState *ed) {
-    int visible_rows = ed->screen_rows - 2;
-    int sel_start, sel_end;
-    get_selection_range(ed, &sel_start, &sel_end);
+    PaneView *v = view(ed);
+    WINDOW *win = v->win;
+    int visible_rows = ed->view_rows;
+    Selection sel;
+    get_selection(ed, &sel);
+
+    int gutter = gutter_width(ed);
+    if (ed->offset_x != v->drawn_offset_x || gutter != v->drawn_gutter) {
+        mark_all_dirty(ed);
+    }
+
+    // Scroll what is already on screen (the terminal does this with a
+    // scroll region) and paint only the rows that came into view.
+    int delta = ed->offset_y - v->drawn_offset_y;
+    if (delta != 0 && !ed->dirty_all && abs(delta) < visible_rows) {
+        scrollok(win, TRUE);
+        wscrl(win, delta);
+        scrollok(win, FALSE);
+        if (delta > 0) {
+            memmove(v->drawn_states, v->drawn_states + delta,
+                    (visible_rows - delta) * sizeof(int));
+            mark_dirty(ed, ed->offset_y + visible_rows - delta,
+                       ed->offset_y + visible_rows - 1);
+        } else {
+            memmove(v->drawn_states - delta, v->drawn_states,
+                    (visible_rows + delta) * sizeof(int));
+            mark_dirty(ed, ed->offset_y, ed->offset_y - delta - 1);
+        }
+    } else if (delta != 0) {
+        mark_all_dirty(ed);
+    }
+
+    // Only the rows the selection covers, now or at the last paint.
+    if (memcmp(&sel, &v->drawn_sel, sizeof(Selection)) != 0) {
+        if (v->drawn_sel.mode != SEL_NONE) {
+            mark_dirty(ed, v->drawn_sel.y1, v->drawn_sel.y2);
+        }
+        if (sel.mode != SEL_NONE) mark_dirty(ed, sel.y1, sel.y2);
+    }
+
+    // An edit can restyle the rows below it (say, by opening a comment),
+    // so a row is also redrawn when it starts in a different lexer state
+    // than it was drawn in.
+    const SyntaxLang *lang = ed->syntax.lang;
+    int state = syntax_state_at(&ed->syntax, &ed->buf, ed->offset_y);
 
     for (int screen_row = 0; screen_row < visible_rows; screen_row++) {
         int file_line = ed->offset_y + screen_row;
-        if (file_line >= ed->line_count) break;
+        if (ed->dirty_all || state != v->drawn_states[screen_row] ||
+            (file_line >= ed->dirty_from && file_line <= ed->dirty_to)) {
+            draw_text_row(ed, screen_row, &sel, state);
+        }
+        v->drawn_states[screen_row] = state;
 
-        int screen_y = screen_row + 1;
-        int is_selected = ed->selecting &&
-                          file_line >= sel_start &&
-                          file_line <= sel_end;
+        if (lang && file_line < ed->buf.line_count) {
+            Line line = buffer_line(&ed->buf, file_line);
+            state = syntax_line(lang, state, line.text, line.len, NULL);
+        }
+    }
 
-        if (is_selected) attron(A_REVERSE);
+    ed->dirty_all = 0;
+    ed->dirty_from = -1;
+    ed->dirty_to = -1;
+    v->drawn_offset_x = ed->offset_x;
+    v->drawn_offset_y = ed->offset_y;
+    v->drawn_gutter = gutter;
+    v->drawn_sel = sel;
+}
 
-        if (has_colors()) attron(COLOR_PAIR(3));
-        mvprintw(screen_y, 0, "%4d ", file_line + 1);
-        if (has_colors()) attroff(COLOR_PAIR(3));
+// Screen attribute of a highlight class.
+static chtype syntax_attr(int hl) {
+    if (hl == HL_NORMAL) return 0;
+    if (!has_colors()) {
+        if (hl == HL_COMMENT) return A_DIM;
+        return (hl == HL_KEYWORD || hl == HL_SECTION) ? A_BOLD : 0;
+    }
 
-        char *line = ed->lines[file_line];
-        int line_len = strlen(line);
-        int visible_cols = ed->screen_cols - 5;
+    chtype attr = COLOR_PAIR(6 + hl);
+    if (hl == HL_KEYWORD || hl == HL_PREPROC || hl == HL_SECTION ||
+        hl == HL_VARIABLE) {
+        attr |= A_BOLD;
+    }
+    return attr;
+}
+
+// Add one character with its attributes (and the window's).
+static void put_char(WINDOW *win, wchar_t wc, chtype attr) {
+    wchar_t text[2] = { wc, L'\0' };
+    cchar_t cc;
+    setcchar(&cc, text, attr & A_ATTRIBUTES & ~A_COLOR, PAIR_NUMBER(attr),
+             NULL);
+    wadd_wch(win, &cc);
+}
 
-        for (int x = ed->offset_x;
-             x < ed->offset_x + visible_cols && x < line_len;
-             x++) {
-            mvaddch(screen_y, 5 + (x - ed->offset_x), line[x]);
+void draw_text_row(EditorState *ed, int screen_row, const Selection *sel,
+                   int state) {
+    WINDOW *win = view(ed)->win;
+    int file_line = ed->offset_y + screen_row;
+
+    wmove(win, screen_row, 0);
+    if (file_line >= ed->buf.line_count) {
+        wclrtoeol(win);
+        return;
+    }
+
+    int in_sel = sel->mode != SEL_NONE &&
+                 file_line >= sel->y1 && file_line <= sel->y2;
+    int is_selected = in_sel && sel->mode == SEL_LINES;
+
+    if (is_selected) wattron(win, A_REVERSE);
+
+    if (has_colors()) wattron(win, COLOR_PAIR(3));
+    int gutter = gutter_width(ed);
+    wprintw(win, "%*d ", gutter - 1, file_line + 1);
+    if (has_colors()) wattroff(win, COLOR_PAIR(3));
+
+    Line line = buffer_line(&ed->buf, file_line);
+    int visible_cols = ed->view_cols - gutter;
+    int end_col = ed->offset_x + visible_cols;
+
+    // Start at the character that covers the left edge.
+    const ColumnMap *map = columns_get(&ed->columns, &ed->buf, file_line);
+    int x = columns_byte(map, ed->offset_x);
+    int col = columns_col(map, x);
+
+    // Bytes sel_from..sel_to are selected with Shift or in a block.
+    int sel_from = 0, sel_to = 0;
+    if (in_sel && sel->mode == SEL_CHARS) {
+        sel_from = file_line == sel->y1 ? sel->x1 : 0;
+        sel_to = file_line == sel->y2 ? sel->x2 : INT_MAX;
+    } else if (in_sel && sel->mode == SEL_BLOCK) {
+        sel_from = columns_byte(map, sel->col1);
+        sel_to = columns_byte(map, sel->col2);
+    }
+
+    // The other cursors on this line, if there are several.
+    int caret = caret_first(ed, file_line);
+    const Caret *carets = ed->carets;
+    int caret_end = caret;
+    while (caret_end < ed->caret_count && carets[caret_end].y == file_line) {
+        caret_end++;
+    }
+
+    // Matches are highlighted while the Find prompt is open; the one
+    // under the cursor stands out.
+    int qlen = (int)ed->search.len;
+    int match = (ed->searching && qlen > 0) ?
+                search_line(&ed->search, line, x - qlen + 1) : -1;
+
+    const unsigned char *hl = ed->syntax.lang ?
+                              syntax_highlight(&ed->syntax, state, line) : NULL;
+
+    while (x < line.len && col < end_col) {
+        wchar_t wc;
+        int n = utf8_decode(line.text, line.len, x, &wc);
+        int width = utf8_char_width(wc, col);
+
+        while (match >= 0 && x >= match + qlen) {
+            match = search_line(&ed->search, line, match + 1);
         }
 
-        if (is_selected) attroff(A_REVERSE);
+        chtype attr = hl ? syntax_attr(hl[x]) : 0;
+        if (match >= 0 && x >= match) {
+            if (ed->search_hit && file_line == ed->cursor_y &&
+                match == ed->cursor_x) {
+                attr = A_REVERSE;
+            } else {
+                attr = has_colors() ? COLOR_PAIR(6) : A_UNDERLINE;
+            }
+        }
+        if (x >= sel_from && x < sel_to) attr |= A_REVERSE;
+        while (caret < caret_end && carets[caret].x < x) caret++;
+        if (caret < caret_end && carets[caret].x == x) attr |= A_REVERSE;
+
+        // Tabs, and wide characters cut by either edge, become blanks.
+        if (wc == '\t' || col < ed->offset_x || col + width > end_col) {
+            int from = col > ed->offset_x ? col : ed->offset_x;
+            int to = col + width < end_col ? col + width : end_col;
+            for (int c = from; c < to; c++) put_char(win, ' ', attr);
+        } else if (wc < 0x20 || wc == 0x7F) {
+            put_char(win, 0xFFFD, attr);
+        } else {
+            put_char(win, wc, attr);
+        }
+
+        col += width;
+        x += n;
     }
+
+    // Past the end: a selected line break, or the columns of a block
+    // that a short line does not reach.
+    if (x >= line.len && (sel_to == INT_MAX || sel->mode == SEL_BLOCK)) {
+        int from = col, to = col + 1;
+        if (sel->mode == SEL_BLOCK) {
+            from = sel->col1 > col ? sel->col1 : col;
+            to = in_sel ? sel->col2 : col;
+        }
+        if (to > end_col) to = end_col;
+        for (int c = col > ed->offset_x ? col : ed->offset_x; c < to; c++) {
+            put_char(win, ' ', c >= from ? A_REVERSE : 0);
+        }
+    } else if (x >= line.len && caret_end > 0 &&
+               carets[caret_end - 1].y == file_line &&
+               carets[caret_end - 1].x >= line.len &&
+               col >= ed->offset_x && col < end_col) {
+        put_char(win, ' ', A_REVERSE);
+    }
+
+    if (is_selected) wattroff(win, A_REVERSE);
+    if (getcurx(win) > 0) wclrtoeol(win);
 }
 
-void draw_status_bar(EditorState *ed) {
-    int status_y = ed->screen_rows - 1;
+// Lay out a status bar field at column x, clipped to the bar.
+static void status_put(char *bar, int cols, int x, const char *text) {
+    for (int i = 0; text[i] && x + i < cols; i++) {
+        if (x + i >= 0) bar[x + i] = text[i];
+    }
+}
 
-    if (has_colors()) attron(COLOR_PAIR(2));
-    else attron(A_REVERSE);
+// Key-to-paint times of the last TRACE_WINDOW keys, after the mode.
+static void latency_status(char *mode, size_t size) {
+    TraceStats stats;
+    trace_stats(TRACE_KEY_TO_PAINT, &stats);
+    size_t len = strlen(mode);
+    if (stats.count == 0) {
+        snprintf(mode + len, size - len, "  key to paint: -");
+        return;
+    }
+    snprintf(mode + len, size - len,
+             "  key to paint p50 %.1f p99 %.1f max %.1f ms",
+             stats.p50 / 1e6, stats.p99 / 1e6, stats.max / 1e6);
+}
 
-    mvprintw(status_y, 0, " %s%s ",
+// File name, mode and cursor position.
+static void file_status(EditorState *ed, char *bar, int cols) {
+    char left_info[300];
+    snprintf(left_info, sizeof(left_info), " %s%s ",
              ed->filename ? ed->filename : "[New File]",
              ed->modified ? " [+]" : "");
-
-    const char *mode = ed->insert_mode ? "INSERT" : "OVERWRITE";
-    int center_x = (ed->screen_cols - (int)strlen(mode)) / 2;
-    mvprintw(status_y, center_x, "%s", mode);
+    status_put(bar, cols, 0, left_info);
+
+    char mode[96];
+    snprintf(mode, sizeof(mode), "%s", ed->insert_mode ? "INSERT" : "OVERWRITE");
+    if (ed->caret_count > 0) {
+        size_t len = strlen(mode);
+        snprintf(mode + len, sizeof(mode) - len, "  %d cursors",
+                 ed->caret_count + 1);
+    }
+    if (ed->show_latency) latency_status(mode, sizeof(mode));
+    status_put(bar, cols, (cols - (int)strlen(mode)) / 2, mode);
 
     char right_info[64];
     snprintf(right_info, sizeof(right_info),
-             "Ln %d/%d, Col %d ",
-             ed->cursor_y + 1, ed->line_count, ed->cursor_x + 1);
-    mvprintw(status_y,
-             ed->screen_cols - (int)strlen(right_info),
-             "%s", right_info);
+             "Ln %d/%d%s, Col %d ",
+             ed->cursor_y + 1, ed->buf.line_count,
+             buffer_loading(&ed->buf) ? "+" : "", cursor_col(ed) + 1);
+    status_put(bar, cols, cols - (int)strlen(right_info), right_info);
+}
+
+// Progress of a replace-all.
+static void replace_status(EditorState *ed, char *bar, int cols) {
+    char left_info[96];
+    snprintf(left_info, sizeof(left_info), " Replacing... %d%%, %ld matches",
+             replace_progress(&ed->replace),
+             atomic_load(&ed->replace.matches));
+    status_put(bar, cols, 0, left_info);
 
-    for (int x = 0; x < ed->screen_cols; x++) {
-        mvaddch(status_y, x, mvinch(status_y, x) & A_CHARTEXT);
+    const char *right_info = "Esc:Cancel ";
+    status_put(bar, cols, cols - (int)strlen(right_info), right_info);
+}
+
+// The Find prompt and which match the cursor is on ("3/120"; a "+"
+// means matches are still being counted).
+static void search_status(EditorState *ed, char *bar, int cols) {
+    SearchIndex *s = &ed->search;
+    status_put(bar, cols, 0, " Find: ");
+    status_put(bar, cols, 7, s->query ? s->query : "");
+
+    char right_info[64] = "";
+    if (s->len > 0 && !ed->search_hit) {
+        snprintf(right_info, sizeof(right_info), "No matches ");
+    } else if (s->len > 0) {
+        SearchHit hit = { ed->cursor_y, ed->cursor_x };
+        int rank = search_rank(s, hit);
+        int complete = search_complete(s, &ed->buf);
+        if (rank > 0) {
+            snprintf(right_info, sizeof(right_info), "%d/%d%s ",
+                     rank, s->hit_count, complete ? "" : "+");
+        } else {
+            snprintf(right_info, sizeof(right_info), "?/%d+ ",
+                     s->hit_count);
+        }
     }
+    status_put(bar, cols, cols - (int)strlen(right_info), right_info);
+}
 
-    if (has_colors()) attroff(COLOR_PAIR(2));
-    else attroff(A_REVERSE);
+void draw_status_bar(EditorState *ed) {
+    int status_y = ed->screen_rows - 1;
+    int cols = ed->screen_cols;
+    char *bar = (char *)malloc(cols + 1);
+    memset(bar, ' ', cols);
+    bar[cols] = '\0';
+
+    // Messages wait while the Find prompt or a replace-all is up.
+    Message *msg = (ed->searching || ed->replacing) ? NULL :
+                   current_message(ed);
+    if (msg) {
+        status_put(bar, cols, 2, msg->text);
+        if (strcmp(bar, screen.drawn_status) != 0) {
+            mvaddnstr(status_y, 0, bar, cols);
+            strcpy(screen.drawn_status, bar);
+        }
+        free(bar);
+        return;
+    }
+
+    if (ed->replacing) replace_status(ed, bar, cols);
+    else if (ed->searching) search_status(ed, bar, cols);
+    else file_status(ed, bar, cols);
+
+    if (strcmp(bar, screen.drawn_status) != 0) {
+        if (has_colors()) attron(COLOR_PAIR(2));
+        else attron(A_REVERSE);
+
+        mvaddnstr(status_y, 0, bar, cols);
+
+        if (has_colors()) attroff(COLOR_PAIR(2));
+        else attroff(A_REVERSE);
+
+        strcpy(screen.drawn_status, bar);
+    }
+    free(bar);
 }
 
-void show_message(EditorState *ed, const char *msg, int duration_ms) {
-    int msg_y = ed->screen_rows - 1;
-    move(msg_y, 0);
+// FILE OPS
+// A yes/no question on the status row.
+int ask_user(EditorState *ed, const char *question) {
+    mvprintw(ed->screen_rows - 1, 0, "%s (y/n): ", question);
     clrtoeol();
-    mvprintw(msg_y, 2, "%s", msg);
     refresh();
-    napms(duration_ms);
+    int response = getch();
+    mark_status_dirty(ed);
+    return response == 'y' || response == 'Y';
 }
 
-// FILE OPS
 void save_file(EditorState *ed) {
     if (!ed->filename) {
         char filename[256];
@@ -271,330 +777,679 @@ void save_file(EditorState *ed) {
         noecho();
         if (strlen(filename) > 0) {
             ed->filename = strdup(filename);
+            syntax_select(&ed->syntax, filename, buffer_line(&ed->buf, 0));
+            mark_changed(ed, 0, DIRTY_TO_END);
+            mark_all_dirty(ed);
+            mark_status_dirty(ed);
+            ed->dirty_menu = 1;
         } else {
             show_message(ed, "Save cancelled", 1000);
             return;
         }
     }
+    if (recording) fputs("save\n", recording);
+    write_file(ed);
+}
 
-    FILE *file = fopen(ed->filename, "w");
-    if (!file) {
-        show_message(ed, "ERROR: Cannot save file!", 2000);
-        return;
+// 1 if a pane shows a followed file.
+int following(EditorState *ed) {
+    for (int i = 0; i < ed->pane_count; i++) {
+        int tab = ed->panes[i].tab;
+        if (tab == ed->tab ? ed->follow != NULL : ed->tabs[tab].follow != NULL) {
+            return 1;
+        }
     }
+    return 0;
+}
 
-    for (int i = 0; i < ed->line_count; i++) {
-        fprintf(file, "%s\n", ed->lines[i]);
+// TABS
+// Ctrl+Q: offer to save every modified file, then exit.
+void quit_editor(EditorState *ed) {
+    for (int i = 0; i < ed->tab_count; i++) {
+        int modified = i == ed->tab ? ed->modified : ed->tabs[i].modified;
+        if (!modified) continue;
+        switch_tab(ed, i);
+        draw_screen(ed);
+        if (!confirm_save(ed)) return;
     }
+    exit_editor(ed);
+}
 
-    fclose(file);
-    ed->modified = 0;
-    show_message(ed, "File saved successfully!", 1000);
+void exit_editor(EditorState *ed) {
+    cleanup_editor(ed);
+    set_bracketed_paste(0);
+    endwin();
+    exit(0);
 }
 
-void open_file(EditorState *ed, const char *filename) {
-    FILE *file = fopen(filename, "r");
-    if (!file) {
-        show_message(ed, "ERROR: Cannot open file!", 2000);
-        return;
+// Called from the main loop: let go of the file images of the tabs no
+// pane shows, once their indexers are done with them.
+void trim_tabs(EditorState *ed) {
+    for (int i = 0; i < ed->tab_count; i++) {
+        Tab *t = &ed->tabs[i];
+        int shown = 0;
+        for (int k = 0; k < ed->pane_count; k++) {
+            if (ed->panes[k].tab == i) shown = 1;
+        }
+        if (!shown && !t->trimmed) t->trimmed = buffer_trim(&t->buf);
     }
+}
 
-    for (int i = 0; i < ed->line_count; i++) {
-        free(ed->lines[i]);
-    }
+// PANES
+// Panes tile the text area. Each has its own window, cursor and scroll
+// position and keeps its own redraw bookkeeping, so an edit repaints
+// only the panes showing the edited tab. The screen is split by halving
+// a pane, and a closed pane's area goes back to the other half.
+static void store_pane(EditorState *ed, Pane *p) {
+    p->rows = ed->view_rows;
+    p->cols = ed->view_cols;
+    p->cursor_x = ed->cursor_x;
+    p->cursor_y = ed->cursor_y;
+    p->offset_x = ed->offset_x;
+    p->offset_y = ed->offset_y;
+    p->selecting = ed->selecting;
+    p->sel_y = ed->sel_y;
+    p->sel_x = ed->sel_x;
+    p->sel_col = ed->sel_col;
+    p->block_col = ed->block_col;
+    p->dirty_from = ed->dirty_from;
+    p->dirty_to = ed->dirty_to;
+    p->dirty_all = ed->dirty_all;
+    p->carets = ed->carets;
+    p->caret_count = ed->caret_count;
+    p->caret_cap = ed->caret_cap;
+}
 
-    ed->line_count = 0;
-    char buffer[MAX_LINE_LENGTH];
+static void load_pane(EditorState *ed, Pane *p) {
+    ed->view_rows = p->rows;
+    ed->view_cols = p->cols;
+    ed->cursor_x = p->cursor_x;
+    ed->cursor_y = p->cursor_y;
+    ed->offset_x = p->offset_x;
+    ed->offset_y = p->offset_y;
+    ed->selecting = p->selecting;
+    ed->sel_y = p->sel_y;
+    ed->sel_x = p->sel_x;
+    ed->sel_col = p->sel_col;
+    ed->block_col = p->block_col;
+    ed->dirty_from = p->dirty_from;
+    ed->dirty_to = p->dirty_to;
+    ed->dirty_all = p->dirty_all;
+    ed->carets = p->carets;
+    ed->caret_count = p->caret_count;
+    ed->caret_cap = p->caret_cap;
+}
 
-    while (fgets(buffer, sizeof(buffer), file) &&
-           ed->line_count < MAX_LINES) {
-        size_t len = strlen(buffer);
-        if (len > 0 && buffer[len - 1] == '\n') {
-            buffer[len - 1] = '\0';
-        }
-        ed->lines[ed->line_count] =
-            (char *)calloc(MAX_LINE_LENGTH, sizeof(char));
-        strcpy(ed->lines[ed->line_count], buffer);
-        ed->line_count++;
-    }
+// Make pane n the one EditorState works on, along with its tab.
+void use_pane(EditorState *ed, int n) {
+    if (n == ed->pane) return;
+    store_pane(ed, &ed->panes[ed->pane]);
 
-    fclose(file);
+    int tab = ed->panes[n].tab;
+    if (tab != ed->tab) {
+        store_tab(ed, &ed->tabs[ed->tab]);
+        ed->tab = tab;
+        load_tab(ed, &ed->tabs[tab]);
+    }
+    ed->pane = n;
+    load_pane(ed, &ed->panes[n]);
+}
 
-    if (ed->line_count == 0) {
-        ed->lines[0] = (char *)calloc(MAX_LINE_LENGTH, sizeof(char));
-        ed->line_count = 1;
+// Make a window for every pane to fit its area; all are repainted.
+void layout_panes(EditorState *ed) {
+    store_pane(ed, &ed->panes[ed->pane]);
+    int bottom = ed->screen_rows - 1;
+
+    for (int i = 0; i < ed->pane_count; i++) {
+        Pane *p = &ed->panes[i];
+        PaneView *v = &screen.panes[i];
+        p->rows = p->height - (p->top + p->height < bottom);
+        p->cols = p->width - (p->left + p->width < ed->screen_cols);
+        if (p->rows < 1) p->rows = 1;
+        if (p->cols < 1) p->cols = 1;
+
+        // Windows are kept across layouts: handle_input() tells by the
+        // window whether a key moved it to another pane.
+        if (v->win) {
+            wresize(v->win, p->rows, p->cols);
+            mvwin(v->win, p->top, p->left);
+        } else {
+            v->win = newwin(p->rows, p->cols, p->top, p->left);
+            keypad(v->win, TRUE);
+            idlok(v->win, TRUE);
+        }
+        free(v->drawn_states);
+        v->drawn_states = (int *)calloc(p->rows, sizeof(int));
+        p->dirty_all = 1;
+        v->drawn_offset_x = p->offset_x;
+        v->drawn_offset_y = p->offset_y;
+        v->drawn_sel.mode = SEL_NONE;
     }
 
-    if (ed->filename) free(ed->filename);
-    ed->filename = strdup(filename);
-    ed->cursor_x = 0;
-    ed->cursor_y = 0;
-    ed->offset_x = 0;
-    ed->offset_y = 0;
-    ed->modified = 0;
+    load_pane(ed, &ed->panes[ed->pane]);
+    erase();
+    mark_status_dirty(ed);
+    ed->dirty_menu = 1;
 }
 
-// EDIT OPS
-void insert_char(EditorState *ed, char ch) {
-    char *line = ed->lines[ed->cursor_y];
-    int len = strlen(line);
-
-    if (len >= MAX_LINE_LENGTH - 1) {
-        show_message(ed, "Line too long!", 1000);
+// F5 / F6: split the active pane into two, one above the other or side by
+// side. Both show the same place; the new one, below or on the right,
+// becomes active.
+void split_pane(EditorState *ed, int side_by_side) {
+    Pane *p = &ed->panes[ed->pane];
+    int size = side_by_side ? p->width : p->height;
+    int min = side_by_side ? PANE_MIN_COLS : PANE_MIN_ROWS;
+    if (size < 2 * min + 1) {
+        show_message(ed, "Pane is too small to split", 1000);
         return;
     }
 
-    if (ed->insert_mode) {
-        memmove(line + ed->cursor_x + 1,
-                line + ed->cursor_x,
-                len - ed->cursor_x + 1);
+    store_pane(ed, p);
+    int at = ed->pane + 1;
+    ed->panes = (Pane *)realloc(ed->panes,
+                                (ed->pane_count + 1) * sizeof(Pane));
+    memmove(&ed->panes[at + 1], &ed->panes[at],
+            (ed->pane_count - at) * sizeof(Pane));
+    screen.panes = (PaneView *)realloc(screen.panes,
+                                       (ed->pane_count + 1) * sizeof(PaneView));
+    memmove(&screen.panes[at + 1], &screen.panes[at],
+            (ed->pane_count - at) * sizeof(PaneView));
+    memset(&screen.panes[at], 0, sizeof(PaneView));
+    ed->pane_count++;
+
+    p = &ed->panes[ed->pane];
+    Pane *q = &ed->panes[at];
+    *q = *p;
+    q->carets = NULL;
+    q->caret_count = q->caret_cap = 0;
+    if (side_by_side) {
+        q->left = p->left + p->width / 2;
+        q->width = p->left + p->width - q->left;
+        p->width = q->left - p->left;
+    } else {
+        q->top = p->top + p->height / 2;
+        q->height = p->top + p->height - q->top;
+        p->height = q->top - p->top;
     }
 
-    line[ed->cursor_x] = ch;
-    ed->cursor_x++;
-    ed->modified = 1;
-
+    ed->pane = at;
+    load_pane(ed, q);
+    layout_panes(ed);
     scroll_if_needed(ed);
 }
 
-void delete_char_backspace(EditorState *ed) {
-    if (ed->cursor_x > 0) {
-        char *line = ed->lines[ed->cursor_y];
-        int len = strlen(line);
-        memmove(line + ed->cursor_x - 1,
-                line + ed->cursor_x,
-                len - ed->cursor_x + 1);
-        ed->cursor_x--;
-        ed->modified = 1;
-    } else if (ed->cursor_y > 0) {
-        int prev_len = strlen(ed->lines[ed->cursor_y - 1]);
-        if (prev_len + (int)strlen(ed->lines[ed->cursor_y]) <
-            MAX_LINE_LENGTH) {
-            strcat(ed->lines[ed->cursor_y - 1],
-                   ed->lines[ed->cursor_y]);
-            free(ed->lines[ed->cursor_y]);
-            for (int i = ed->cursor_y; i < ed->line_count - 1; i++) {
-                ed->lines[i] = ed->lines[i + 1];
-            }
-            ed->line_count--;
-            ed->cursor_y--;
-            ed->cursor_x = prev_len;
-            ed->modified = 1;
-        }
+// F7: move to pane n.
+void focus_pane(EditorState *ed, int n) {
+    if (n == ed->pane) return;
+    use_pane(ed, n);
+
+    // Edits made through another pane may have moved the text under the
+    // cursor, and under any others it had.
+    if (ed->cursor_y >= ed->buf.line_count) {
+        ed->cursor_y = ed->buf.line_count - 1;
     }
+    const ColumnMap *map = columns_get(&ed->columns, &ed->buf, ed->cursor_y);
+    ed->cursor_x = columns_byte(map, columns_col(map, ed->cursor_x));
+    drop_carets(ed);
+    ed->jump.kind = JUMP_NONE;
+
+    undo_seal(&ed->undo);
     scroll_if_needed(ed);
+    mark_status_dirty(ed);
+    ed->dirty_menu = 1;
 }
 
-void insert_newline(EditorState *ed) {
-    if (ed->line_count >= MAX_LINES) {
-        show_message(ed, "Maximum lines reached!", 1000);
-        return;
+// 1 if q lies along the given side of p (0 left, 1 right, 2 above,
+// 3 below) and within its length.
+static int pane_beside(const Pane *p, const Pane *q, int side) {
+    if (side < 2) {
+        int edge = side == 0 ? q->left + q->width == p->left :
+                               q->left == p->left + p->width;
+        return edge && q->top >= p->top &&
+               q->top + q->height <= p->top + p->height;
     }
+    int edge = side == 2 ? q->top + q->height == p->top :
+                           q->top == p->top + p->height;
+    return edge && q->left >= p->left &&
+           q->left + q->width <= p->left + p->width;
+}
 
-    char *current = ed->lines[ed->cursor_y];
-    char *new_line = (char *)calloc(MAX_LINE_LENGTH, sizeof(char));
-
-    strcpy(new_line, current + ed->cursor_x);
-    current[ed->cursor_x] = '\0';
-
-    for (int i = ed->line_count; i > ed->cursor_y + 1; i--) {
-        ed->lines[i] = ed->lines[i - 1];
+// Stretch the panes along one side of pane n over its area, picking a
+// side they cover exactly (the other half of the split that made n
+// always does). Returns one of them, or -1.
+static int absorb_pane(EditorState *ed, int n) {
+    Pane *p = &ed->panes[n];
+    for (int side = 0; side < 4; side++) {
+        int length = side < 2 ? p->height : p->width;
+        int covered = 0;
+        for (int i = 0; i < ed->pane_count; i++) {
+            Pane *q = &ed->panes[i];
+            if (i != n && pane_beside(p, q, side)) {
+                covered += side < 2 ? q->height : q->width;
+            }
+        }
+        if (covered != length) continue;
+
+        int heir = -1;
+        for (int i = 0; i < ed->pane_count; i++) {
+            Pane *q = &ed->panes[i];
+            if (i == n || !pane_beside(p, q, side)) continue;
+            if (side == 1) q->left = p->left;
+            if (side == 3) q->top = p->top;
+            if (side < 2) q->width += p->width;
+            else q->height += p->height;
+            heir = i;
+        }
+        return heir;
     }
+    return -1;
+}
 
-    ed->lines[ed->cursor_y + 1] = new_line;
-    ed->line_count++;
-    ed->cursor_y++;
-    ed->cursor_x = 0;
-    ed->modified = 1;
-
+// F8: close the active pane. The tab it showed stays open.
+void close_pane(EditorState *ed) {
+    if (ed->pane_count == 1) {
+        show_message(ed, "Only one pane", 800);
+        return;
+    }
+    int n = ed->pane;
+    int heir = absorb_pane(ed, n);
+    if (heir < 0) return;
+
+    focus_pane(ed, heir);
+    free(ed->panes[n].carets);
+    memmove(&ed->panes[n], &ed->panes[n + 1],
+            (ed->pane_count - n - 1) * sizeof(Pane));
+    delwin(screen.panes[n].win);
+    free(screen.panes[n].drawn_states);
+    memmove(&screen.panes[n], &screen.panes[n + 1],
+            (ed->pane_count - n - 1) * sizeof(PaneView));
+    ed->pane_count--;
+    if (ed->pane > n) ed->pane--;
+
+    layout_panes(ed);
     scroll_if_needed(ed);
 }
 
-void copy_line(EditorState *ed) {
-    if (clipboard) free(clipboard);
-    clipboard = strdup(ed->lines[ed->cursor_y]);
-    show_message(ed, "Line copied", 800);
-}
+// GO TO
+// Ctrl+G asks for a line number, or a byte offset after '@'.
+void go_to_prompt(EditorState *ed) {
+    char where[32];
+    echo();
+    mvprintw(ed->screen_rows - 1, 0, "Go to line (@ for a byte offset): ");
+    clrtoeol();
+    getnstr(where, sizeof(where) - 1);
+    noecho();
+    mark_status_dirty(ed);
+    if (strlen(where) == 0) return;
 
-void cut_line(EditorState *ed) {
-    if (clipboard) free(clipboard);
-    clipboard = strdup(ed->lines[ed->cursor_y]);
+    record_text("goto ", where, strlen(where));
+    ed->selecting = SEL_NONE;
+    drop_carets(ed);
+    if (go_to(ed, where) != 0) show_message(ed, "Not a line number", 1000);
+}
 
-    free(ed->lines[ed->cursor_y]);
+// SEARCH
+// Ctrl+F opens the Find prompt with the last query, which the first key
+// typed replaces. Matches are looked up from where the prompt opened.
+void start_search(EditorState *ed) {
+    ed->searching = 1;
+    ed->search_fresh = ed->search.len > 0;
+    ed->search_origin_y = ed->cursor_y;
+    ed->search_origin_x = ed->cursor_x;
+    ed->selecting = SEL_NONE;
+    search_update(ed);
+}
 
-    if (ed->line_count == 1) {
-        ed->lines[0] = (char *)calloc(MAX_LINE_LENGTH, sizeof(char));
+// The query changed: move to its first match from the origin.
+void search_update(EditorState *ed) {
+    SearchHit hit;
+    if (search_next(&ed->search, &ed->buf, ed->search_origin_y,
+                    ed->search_origin_x, 1, &hit)) {
+        ed->cursor_y = hit.y;
+        ed->cursor_x = hit.x;
+        ed->search_hit = 1;
     } else {
-        for (int i = ed->cursor_y; i < ed->line_count - 1; i++) {
-            ed->lines[i] = ed->lines[i + 1];
-        }
-        ed->line_count--;
-        if (ed->cursor_y >= ed->line_count)
-            ed->cursor_y = ed->line_count - 1;
+        ed->cursor_y = ed->search_origin_y;
+        ed->cursor_x = ed->search_origin_x;
+        ed->search_hit = 0;
     }
-
-    ed->cursor_x = 0;
-    ed->modified = 1;
+    mark_all_dirty(ed);
     scroll_if_needed(ed);
-    show_message(ed, "Line cut", 800);
 }
 
-void copy_selection(EditorState *ed) {
-    int start, end;
-    get_selection_range(ed, &start, &end);
-    if (start == -1) {
-        copy_line(ed);
+// Jump to the next (dir > 0) or previous match of the last query.
+void search_jump(EditorState *ed, int dir) {
+    if (ed->search.len == 0) return;
+
+    SearchHit hit;
+    int found = dir > 0 ?
+        search_next(&ed->search, &ed->buf, ed->cursor_y, ed->cursor_x, 0, &hit) :
+        search_prev(&ed->search, &ed->buf, ed->cursor_y, ed->cursor_x, &hit);
+    ed->search_hit = found;
+    if (!found) {
+        if (!ed->searching) show_message(ed, "Not found", 1000);
         return;
     }
 
-    size_t buf_size = 0;
-    for (int i = start; i <= end; i++) {
-        buf_size += strlen(ed->lines[i]) + 1;
-    }
-    char *buf = (char *)malloc(buf_size + 1);
-    buf[0] = '\0';
-
-    for (int i = start; i <= end; i++) {
-        strcat(buf, ed->lines[i]);
-        if (i != end) strcat(buf, "\n");
-    }
+    ed->cursor_y = hit.y;
+    ed->cursor_x = hit.x;
+    ed->search_fresh = 0;
+    undo_seal(&ed->undo);
+    mark_all_dirty(ed);
+    scroll_if_needed(ed);
+}
 
-    if (clipboard) free(clipboard);
-    clipboard = buf;
+void search_key(EditorState *ed, int ch) {
+    SearchIndex *s = &ed->search;
 
-    show_message(ed, "Selection copied", 800);
-}
+    switch (ch) {
+        case 27:  // Esc: back to where the search started
+            ed->cursor_y = ed->search_origin_y;
+            ed->cursor_x = ed->search_origin_x;
+            ed->searching = 0;
+            mark_all_dirty(ed);
+            scroll_if_needed(ed);
+            break;
 
-void cut_selection(EditorState *ed) {
-    int start, end;
-    get_selection_range(ed, &start, &end);
-    if (start == -1) {
-        cut_line(ed);
-        return;
-    }
+        case '\n':
+        case KEY_ENTER:  // Stay on the match
+            record_text("find ", ed->search.query, ed->search.len);
+            ed->searching = 0;
+            mark_all_dirty(ed);
+            break;
 
-    copy_selection(ed);
+        case 6:  // Ctrl+F
+        case KEY_DOWN:
+        case KEY_F(3):
+            search_jump(ed, 1);
+            break;
 
-    int count = end - start + 1;
-    for (int i = start; i <= end; i++) {
-        free(ed->lines[i]);
-    }
-    for (int i = start; i + count < ed->line_count; i++) {
-        ed->lines[i] = ed->lines[i + count];
-    }
-    ed->line_count -= count;
+        case KEY_UP:
+        case KEY_F(15):  // Shift+F3
+            search_jump(ed, -1);
+            break;
 
-    if (ed->line_count <= 0) {
-        ed->line_count = 1;
-        ed->lines[0] = (char *)calloc(MAX_LINE_LENGTH, sizeof(char));
-    }
+        case KEY_BACKSPACE:
+        case 127:
+        case 8:
+            if (s->len > 0) {
+                search_set_query(s, &ed->buf, s->query,
+                                 utf8_prev(s->query, (int)s->len));
+                search_update(ed);
+            }
+            ed->search_fresh = 0;
+            break;
 
-    ed->cursor_y = start;
-    if (ed->cursor_y >= ed->line_count)
-        ed->cursor_y = ed->line_count - 1;
-    ed->cursor_x = 0;
-    ed->modified = 1;
-    ed->selecting = 0;
+        case KEY_RESIZE:
+            resize_editor(ed);
+            break;
 
-    scroll_if_needed(ed);
-    show_message(ed, "Selection cut", 800);
+        default:
+            // Bytes of a UTF-8 character are added one at a time; the
+            // query matches bytes, so it does not need them whole.
+            if ((ch >= 32 && ch <= 126) || (ch >= 0x80 && ch <= 0xFF)) {
+                size_t len = ed->search_fresh ? 0 : s->len;
+                char *query = (char *)malloc(len + 1);
+                if (len > 0) memcpy(query, s->query, len);
+                query[len++] = (char)ch;
+                search_set_query(s, &ed->buf, query, len);
+                free(query);
+                ed->search_fresh = 0;
+                search_update(ed);
+            }
+            break;
+    }
 }
 
-void delete_selection(EditorState *ed) {
-    int start, end;
-    get_selection_range(ed, &start, &end);
-    if (start == -1) return;
-
-    int count = end - start + 1;
-    for (int i = start; i <= end; i++) {
-        free(ed->lines[i]);
+// REPLACE
+// Ctrl+R asks for a pattern and its replacement and hands the buffer to
+// the replace workers. Until they are done only Esc (cancel) is taken.
+void start_replace(EditorState *ed) {
+    char pattern[256];
+    char replacement[256] = "";
+    echo();
+    mvprintw(ed->screen_rows - 1, 0, "Replace (regex): ");
+    clrtoeol();
+    getnstr(pattern, sizeof(pattern) - 1);
+    if (strlen(pattern) > 0) {
+        mvprintw(ed->screen_rows - 1, 0, "Replace with: ");
+        clrtoeol();
+        getnstr(replacement, sizeof(replacement) - 1);
     }
-    for (int i = start; i + count < ed->line_count; i++) {
-        ed->lines[i] = ed->lines[i + count];
+    noecho();
+    mark_status_dirty(ed);
+
+    if (strlen(pattern) == 0) {
+        show_message(ed, "Replace cancelled", 1000);
+        return;
     }
-    ed->line_count -= count;
 
-    if (ed->line_count <= 0) {
-        ed->line_count = 1;
-        ed->lines[0] = (char *)calloc(MAX_LINE_LENGTH, sizeof(char));
+    buffer_finish(&ed->buf);
+    char error[128];
+    if (replace_start(&ed->replace, &ed->buf, pattern, replacement, 0,
+                      error, sizeof(error)) != 0) {
+        char msg[160];
+        snprintf(msg, sizeof(msg), "ERROR: %s", error);
+        show_message(ed, msg, 2000);
+        return;
     }
+    ed->replacing = 1;
+    ed->replace_started = now_ms();
+    ed->selecting = SEL_NONE;
+    drop_carets(ed);
+}
 
-    ed->cursor_y = start;
-    if (ed->cursor_y >= ed->line_count)
-        ed->cursor_y = ed->line_count - 1;
-    ed->cursor_x = 0;
-    ed->modified = 1;
-    ed->selecting = 0;
+// Apply every replacement as one undo step. Lines are done bottom to
+// top, so one that gains line breaks does not move those still to do.
+static void replace_apply(EditorState *ed) {
+    ReplaceJob *job = &ed->replace;
+    int cursor_y = ed->cursor_y;
+    int cursor_x = ed->cursor_x;
+    int lines = 0;
+
+    undo_begin_group(&ed->undo);
+    for (int n = job->chunk_count - 1; n >= 0; n--) {
+        ReplaceChunk *c = &job->chunks[n];
+        for (int i = c->count - 1; i >= 0; i--) {
+            ReplaceEdit *e = &c->edits[i];
+            edit_delete(ed, e->y, e->x, e->y, e->end_x);
+            edit_insert(ed, e->y, e->x, c->text + e->text, e->len);
+            lines++;
+        }
+    }
+    undo_end_group(&ed->undo);
 
+    if (cursor_y >= ed->buf.line_count) cursor_y = ed->buf.line_count - 1;
+    int len = buffer_line(&ed->buf, cursor_y).len;
+    ed->cursor_y = cursor_y;
+    ed->cursor_x = cursor_x < len ? cursor_x : len;
     scroll_if_needed(ed);
-    show_message(ed, "Selection deleted", 800);
+
+    char msg[128];
+    snprintf(msg, sizeof(msg), "Replaced %ld matches on %d lines in %ld ms",
+             atomic_load(&job->matches), lines,
+             now_ms() - ed->replace_started);
+    show_message(ed, msg, 2000);
 }
 
-void paste_clipboard(EditorState *ed) {
-    if (!clipboard) {
-        show_message(ed, "Clipboard is empty", 1000);
-        return;
-    }
+// Called from the main loop: apply the results once the workers are done.
+void replace_poll(EditorState *ed) {
+    if (!ed->replacing || !replace_done(&ed->replace)) return;
 
-    const char *p = clipboard;
-    while (*p) {
-        if (*p == '\n') {
-            insert_newline(ed);
-        } else {
-            insert_char(ed, *p);
-        }
-        p++;
+    replace_wait(&ed->replace);
+    ed->replacing = 0;
+    mark_status_dirty(ed);
+    if (atomic_load(&ed->replace.cancel)) {
+        show_message(ed, "Replace cancelled", 1000);
+    } else {
+        replace_apply(ed);
     }
+    replace_free(&ed->replace);
+}
 
-    show_message(ed, "Pasted", 800);
+// INPUT
+// Wait for a key, then apply it and every key already queued behind it
+// (typing bursts, key repeat) so the screen is drawn once per batch.
+void handle_input(EditorState *ed) {
+    long t0 = trace_begin();
+    int ch = wgetch(view(ed)->win);
+    if (ch == ERR) return;
+    trace_end(TRACE_INPUT, t0);
+
+    // Stop early if a key moved to another pane; its window has not been
+    // drawn yet.
+    WINDOW *win = view(ed)->win;
+    wtimeout(win, 0);
+    do {
+        trace_key();
+        t0 = trace_begin();
+        process_key(ed, ch);
+        trace_end(TRACE_DISPATCH, t0);
+    } while (view(ed)->win == win && (ch = wgetch(win)) != ERR);
 }
 
-// NAVIGATION
-void move_cursor(EditorState *ed, int dy, int dx) {
-    ed->cursor_y += dy;
-    ed->cursor_x += dx;
+// Ask the terminal to wrap pasted text in ESC[200~ ... ESC[201~ so a
+// paste arrives as one block instead of a stream of keystrokes.
+void set_bracketed_paste(int on) {
+    if (on) {
+        define_key("\033[200~", KEY_PASTE_BEGIN);
+        define_key("\033[201~", KEY_PASTE_END);
+    }
+    printf(on ? "\033[?2004h" : "\033[?2004l");
+    fflush(stdout);
+}
 
-    if (ed->cursor_y < 0) ed->cursor_y = 0;
-    if (ed->cursor_y >= ed->line_count)
-        ed->cursor_y = ed->line_count - 1;
+// Ctrl+PgUp/PgDn, and Ctrl+Tab where the terminal tells it from Tab,
+// arrive as escape sequences terminfo has no names for.
+void define_tab_keys(void) {
+    define_key("\033[6;5~", KEY_TAB_NEXT);     // Ctrl+PgDn
+    define_key("\033[5;5~", KEY_TAB_PREV);     // Ctrl+PgUp
+    define_key("\033[27;5;9~", KEY_TAB_NEXT);  // Ctrl+Tab (modifyOtherKeys)
+    define_key("\033[27;6;9~", KEY_TAB_PREV);  // Ctrl+Shift+Tab
+    define_key("\033[9;5u", KEY_TAB_NEXT);     // Ctrl+Tab (CSI u)
+    define_key("\033[9;6u", KEY_TAB_PREV);
+}
 
-    int line_len = strlen(ed->lines[ed->cursor_y]);
-    if (ed->cursor_x < 0) ed->cursor_x = 0;
-    if (ed->cursor_x > line_len) ed->cursor_x = line_len;
+// Alt+Shift+arrows, as xterm and most terminals like it send them.
+void define_block_keys(void) {
+    define_key("\033[1;4A", KEY_BLOCK_UP);
+    define_key("\033[1;4B", KEY_BLOCK_DOWN);
+    define_key("\033[1;4D", KEY_BLOCK_LEFT);
+    define_key("\033[1;4C", KEY_BLOCK_RIGHT);
+}
 
-    scroll_if_needed(ed);
+// Ctrl+Home/End: xterm's sequences, then rxvt's.
+void define_jump_keys(void) {
+    define_key("\033[1;5H", KEY_FILE_START);
+    define_key("\033[1;5F", KEY_FILE_END);
+    define_key("\033[7^", KEY_FILE_START);
+    define_key("\033[8^", KEY_FILE_END);
 }
 
-void move_to_line_start(EditorState *ed) {
-    ed->cursor_x = 0;
-    scroll_if_needed(ed);
+// Collect a bracketed paste and insert it in one go.
+void read_paste(EditorState *ed) {
+    size_t len = 0;
+    size_t cap = 4096;
+    char *text = (char *)malloc(cap);
+
+    wtimeout(view(ed)->win, PASTE_TIMEOUT_MS);
+    int ch;
+    while ((ch = wgetch(view(ed)->win)) != ERR && ch != KEY_PASTE_END) {
+        if (ch > 255) continue;  // stray function keys
+        if (len == cap) {
+            cap *= 2;
+            text = (char *)realloc(text, cap);
+        }
+        text[len++] = (char)ch;
+    }
+    wtimeout(view(ed)->win, 0);
+
+    record_text("paste ", text, len);
+    paste_text(ed, text, len);
+    free(text);
 }
 
-void move_to_line_end(EditorState *ed) {
-    ed->cursor_x = strlen(ed->lines[ed->cursor_y]);
-    scroll_if_needed(ed);
+// Collect the rest of a UTF-8 character that starts with byte ch. The
+// terminal sends its bytes together, so they are read straight away.
+// Returns the length, or 0 if the bytes are not one valid character.
+static int read_utf8(EditorState *ed, int ch, char *seq) {
+    int n = utf8_sequence_length((unsigned char)ch);
+    if (n == 0) return 0;
+
+    seq[0] = (char)ch;
+    wtimeout(view(ed)->win, ESC_DELAY_MS);
+    for (int i = 1; i < n; i++) {
+        int next = wgetch(view(ed)->win);
+        if (next == ERR || next > 0xFF || (next & 0xC0) != 0x80) {
+            if (next != ERR) ungetch(next);
+            n = 0;
+            break;
+        }
+        seq[i] = (char)next;
+    }
+    wtimeout(view(ed)->win, 0);
+
+    wchar_t wc;
+    return n > 0 && utf8_decode(seq, n, 0, &wc) == n ? n : 0;
 }
 
-void scroll_if_needed(EditorState *ed) {
-    int visible_rows = ed->screen_rows - 2;
-    int visible_cols = ed->screen_cols - 5;
+// LIWIT_RECORD=file writes the keys that reach the editing core to file
+// as a keystroke script, which tests/bench_replay plays back.
+void record_key(int ch) {
+    const char *name = key_name(ch);
+    if (recording && name) fprintf(recording, "%s\n", name);
+}
 
-    if (ed->cursor_y < ed->offset_y) {
-        ed->offset_y = ed->cursor_y;
-    } else if (ed->cursor_y >= ed->offset_y + visible_rows) {
-        ed->offset_y = ed->cursor_y - visible_rows + 1;
+// Typed or pasted text, in double quotes with C escapes.
+void record_text(const char *prefix, const char *text, size_t len) {
+    if (!recording) return;
+    fprintf(recording, "%s\"", prefix);
+    for (size_t i = 0; i < len; i++) {
+        unsigned char c = (unsigned char)text[i];
+        if (c == '\n') fputs("\\n", recording);
+        else if (c == '\t') fputs("\\t", recording);
+        else if (c == '"' || c == '\\') fprintf(recording, "\\%c", c);
+        else if (c < 32 || c == 127) fprintf(recording, "\\x%02x", c);
+        else fputc(c, recording);
     }
+    fputs("\"\n", recording);
+}
 
-    if (ed->cursor_x < ed->offset_x) {
-        ed->offset_x = ed->cursor_x;
-    } else if (ed->cursor_x >= ed->offset_x + visible_cols) {
-        ed->offset_x = ed->cursor_x - visible_cols + 1;
+// The editing core's codes for the ncurses keys it takes; see editor.h.
+static const int core_keys[][2] = {
+    {KEY_ENTER, '\n'}, {KEY_BACKSPACE, 127}, {KEY_UP, K_UP},
+    {KEY_DOWN, K_DOWN}, {KEY_LEFT, K_LEFT}, {KEY_RIGHT, K_RIGHT},
+    {KEY_HOME, K_HOME}, {KEY_END, K_END}, {KEY_PPAGE, K_PGUP},
+    {KEY_NPAGE, K_PGDN}, {KEY_DC, K_DELETE}, {KEY_IC, K_INSERT},
+    {KEY_F(2), K_F2}, {KEY_SR, K_SHIFT_UP}, {KEY_SF, K_SHIFT_DOWN},
+    {KEY_SLEFT, K_SHIFT_LEFT}, {KEY_SRIGHT, K_SHIFT_RIGHT},
+    {KEY_SHOME, K_SHIFT_HOME}, {KEY_SEND, K_SHIFT_END},
+    {KEY_SPREVIOUS, K_SHIFT_PGUP}, {KEY_SNEXT, K_SHIFT_PGDN},
+    {KEY_BLOCK_UP, K_BLOCK_UP}, {KEY_BLOCK_DOWN, K_BLOCK_DOWN},
+    {KEY_BLOCK_LEFT, K_BLOCK_LEFT}, {KEY_BLOCK_RIGHT, K_BLOCK_RIGHT},
+    {KEY_FILE_START, K_FILE_START}, {KEY_FILE_END, K_FILE_END},
+};
+
+// Characters and control keys keep their codes; other keys the core
+// does not know become -1.
+static int core_key(int ch) {
+    if (ch < 256) return ch;
+    for (size_t i = 0; i < sizeof(core_keys) / sizeof(core_keys[0]); i++) {
+        if (core_keys[i][0] == ch) return core_keys[i][1];
     }
+    return -1;
 }
 
-// INPUT
-void handle_input(EditorState *ed) {
-    int ch = getch();
+void process_key(EditorState *ed, int ch) {
+    if (ed->replacing) {
+        if (ch == 27) replace_cancel(&ed->replace);  // Esc
+        else if (ch == KEY_RESIZE) resize_editor(ed);
+        return;
+    }
+    if (ed->searching) {
+        search_key(ed, ch);
+        return;
+    }
 
     switch (ch) {
         // FILE
@@ -610,135 +1465,91 @@ void handle_input(EditorState *ed) {
             clrtoeol();
             getnstr(filename, sizeof(filename) - 1);
             noecho();
+            mark_status_dirty(ed);
             if (strlen(filename) > 0) {
-                open_file(ed, filename);
+                open_tab(ed, filename);
             }
         }
             break;
 
         case 17:  // Ctrl+Q
-            if (ed->modified) {
-                mvprintw(ed->screen_rows - 1, 0,
-                         "Save changes? (y/n): ");
-                clrtoeol();
-                refresh();
-                int response = getch();
-                if (response == 'y' || response == 'Y') {
-                    save_file(ed);
-                }
-            }
-            cleanup_editor(ed);
-            endwin();
-            exit(0);
-            break;
-
-        // SELECTION
-        case KEY_F(2):  // Toggle selection mode
-            if (!ed->selecting) {
-                ed->selecting = 1;
-                ed->sel_start_y = ed->sel_end_y = ed->cursor_y;
-                show_message(ed, "Selection started", 800);
-            } else {
-                ed->selecting = 0;
-                show_message(ed, "Selection cleared", 800);
-            }
+            quit_editor(ed);
             break;
 
-        // EDIT
-        case 3:  // Ctrl+C
-            if (ed->selecting) copy_selection(ed);
-            else copy_line(ed);
+        // NAVIGATION
+        case 7:  // Ctrl+G
+            go_to_prompt(ed);
             break;
 
-        case 24:  // Ctrl+X
-            if (ed->selecting) cut_selection(ed);
-            else cut_line(ed);
+        // TABS
+        case 23:  // Ctrl+W: closing the last tab quits
+            if (close_tab(ed)) exit_editor(ed);
             break;
 
-        case 22:  // Ctrl+V
-            paste_clipboard(ed);
+        case KEY_TAB_NEXT:
+            switch_tab(ed, (ed->tab + 1) % ed->tab_count);
             break;
 
-        case KEY_IC:
-            ed->insert_mode = !ed->insert_mode;
+        case KEY_TAB_PREV:
+            switch_tab(ed, (ed->tab + ed->tab_count - 1) % ed->tab_count);
             break;
 
-        // NAVIGATION
-        case KEY_UP:
-            move_cursor(ed, -1, 0);
-            if (ed->selecting) ed->sel_end_y = ed->cursor_y;
+        // PANES
+        case KEY_F(5):
+            split_pane(ed, 0);
             break;
 
-        case KEY_DOWN:
-            move_cursor(ed, 1, 0);
-            if (ed->selecting) ed->sel_end_y = ed->cursor_y;
+        case KEY_F(6):
+            split_pane(ed, 1);
             break;
 
-        case KEY_LEFT:
-            move_cursor(ed, 0, -1);
+        case KEY_F(7):
+            focus_pane(ed, (ed->pane + 1) % ed->pane_count);
             break;
 
-        case KEY_RIGHT:
-            move_cursor(ed, 0, 1);
+        case KEY_F(8):
+            close_pane(ed);
             break;
 
-        case KEY_HOME:
-            move_to_line_start(ed);
+        case KEY_F(12):
+            toggle_latency(ed);
             break;
 
-        case KEY_END:
-            move_to_line_end(ed);
+        // SEARCH
+        case 6:  // Ctrl+F
+            start_search(ed);
             break;
 
-        case KEY_PPAGE:
-            move_cursor(ed, -10, 0);
-            if (ed->selecting) ed->sel_end_y = ed->cursor_y;
+        case KEY_F(3):
+            search_jump(ed, 1);
             break;
 
-        case KEY_NPAGE:
-            move_cursor(ed, 10, 0);
-            if (ed->selecting) ed->sel_end_y = ed->cursor_y;
+        case KEY_F(15):  // Shift+F3
+            search_jump(ed, -1);
             break;
 
-        // TEXT
-        case '\n':
-        case KEY_ENTER:
-            insert_newline(ed);
+        case 18:  // Ctrl+R
+            start_replace(ed);
             break;
 
-        case KEY_BACKSPACE:
-        case 127:
-        case 8:
-            if (ed->selecting) {
-                delete_selection(ed);
-            } else {
-                delete_char_backspace(ed);
-            }
+        case KEY_PASTE_BEGIN:
+            read_paste(ed);
             break;
 
-        case KEY_DC:
-            if (ed->selecting) {
-                delete_selection(ed);
-            } else if (ed->cursor_x <
-                       (int)strlen(ed->lines[ed->cursor_y])) {
-                ed->cursor_x++;
-                delete_char_backspace(ed);
-            }
-            break;
-
-        case '\t':
-            for (int i = 0; i < TAB_SIZE; i++) {
-                insert_char(ed, ' ');
-            }
+        case KEY_RESIZE:
+            resize_editor(ed);
             break;
 
         default:
-            if (ch >= 32 && ch <= 126) {
-                if (ed->selecting) {
-                    // typing clears selection for now
-                    ed->selecting = 0;
-                }
-                insert_char(ed, (char)ch);
+            if ((ch >= 32 && ch <= 126) || (ch >= 0x80 && ch <= 0xFF)) {
+                char seq[4];
+                int len = read_utf8(ed, ch, seq);
+                if (len == 0) break;
+                record_text("", seq, len);
+                type_char(ed, seq, len);
+            } else if ((ch = core_key(ch)) >= 0) {
+                record_key(ch);
+                edit_key(ed, ch);
             }
             break;
     }
@@ -0,0 +1,263 @@
+/*
+ * LIWIT - Linux-Windows Text Editor
+ * Copyright (C) 2026  Khud Bakhtiyar Iqbal Sofi
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "replace.h"
+
+#define MAX_GROUPS 10
+
+// Per-worker state.
+typedef struct {
+    ReplaceJob *job;
+    regex_t *reg;
+    char *line;                // The line being matched, NUL-terminated
+    size_t line_cap;
+} Worker;
+
+// CHUNK RESULTS
+static void chunk_put_text(ReplaceChunk *c, const char *text, size_t len) {
+    if (len == 0) return;
+    if (c->text_len + len > c->text_cap) {
+        size_t cap = c->text_cap ? c->text_cap * 2 : 4096;
+        while (cap < c->text_len + len) cap *= 2;
+        c->text = (char *)realloc(c->text, cap);
+        c->text_cap = cap;
+    }
+    memcpy(c->text + c->text_len, text, len);
+    c->text_len += len;
+}
+
+static ReplaceEdit *chunk_add_edit(ReplaceChunk *c) {
+    if (c->count == c->cap) {
+        c->cap = c->cap ? c->cap * 2 : 64;
+        c->edits = (ReplaceEdit *)realloc(c->edits,
+                                          c->cap * sizeof(ReplaceEdit));
+    }
+    return &c->edits[c->count++];
+}
+
+// Append the replacement for one match to the chunk text.
+static void expand(ReplaceChunk *c, const char *repl, size_t repl_len,
+                   const char *line, const regmatch_t *m) {
+    for (size_t i = 0; i < repl_len; i++) {
+        char ch = repl[i];
+        int group = -1;
+
+        if (ch == '&') {
+            group = 0;
+        } else if (ch == '\\' && i + 1 < repl_len) {
+            ch = repl[++i];
+            if (ch >= '0' && ch <= '9') group = ch - '0';
+            else if (ch == 'n') ch = '\n';
+            else if (ch == 't') ch = '\t';
+        }
+
+        if (group < 0) {
+            chunk_put_text(c, &ch, 1);
+        } else if (m[group].rm_so >= 0) {
+            chunk_put_text(c, line + m[group].rm_so,
+                           m[group].rm_eo - m[group].rm_so);
+        }
+    }
+}
+
+// Match every occurrence in one line. If any, the span from the first
+// match to the end of the last one becomes one edit. Returns the number
+// of matches.
+static long replace_line(Worker *w, ReplaceChunk *c, int y, Line line) {
+    ReplaceJob *job = w->job;
+    if ((size_t)line.len + 1 > w->line_cap) {
+        w->line_cap = line.len + 1 > 256 ? line.len + 1 : 256;
+        w->line = (char *)realloc(w->line, w->line_cap);
+    }
+    if (line.len > 0) memcpy(w->line, line.text, line.len);
+    w->line[line.len] = '\0';
+
+    regmatch_t m[MAX_GROUPS];
+    size_t text_start = c->text_len;
+    int pos = 0;
+    int first = -1;
+    int last_end = -1;
+    long count = 0;
+
+    while (pos <= line.len &&
+           regexec(w->reg, w->line + pos, MAX_GROUPS, m,
+                   pos > 0 ? REG_NOTBOL : 0) == 0) {
+        for (int g = 0; g < MAX_GROUPS; g++) {
+            if (m[g].rm_so >= 0) {
+                m[g].rm_so += pos;
+                m[g].rm_eo += pos;
+            }
+        }
+        int empty = m[0].rm_eo == m[0].rm_so;
+
+        // Like sed, an empty match right after a match does not count.
+        if (!empty || m[0].rm_so != last_end) {
+            if (first < 0) first = m[0].rm_so;
+            else chunk_put_text(c, w->line + pos, m[0].rm_so - pos);
+
+            expand(c, job->replacement, job->replacement_len, w->line, m);
+            count++;
+            last_end = m[0].rm_eo;
+        }
+
+        // After an empty match, keep the next character and move past it.
+        pos = m[0].rm_eo;
+        if (empty) {
+            if (pos >= line.len) break;
+            chunk_put_text(c, w->line + pos, 1);
+            pos++;
+        }
+    }
+    if (count == 0) return 0;
+
+    ReplaceEdit *e = chunk_add_edit(c);
+    e->y = y;
+    e->x = first;
+    e->end_x = pos;
+    e->text = text_start;
+    e->len = c->text_len - text_start;
+    return count;
+}
+
+// WORKER
+static void *replace_thread(void *arg) {
+    Worker *w = (Worker *)arg;
+    ReplaceJob *job = w->job;
+
+    for (;;) {
+        int n = atomic_fetch_add(&job->next_chunk, 1);
+        if (n >= job->chunk_count || atomic_load(&job->cancel)) break;
+
+        ReplaceChunk *c = &job->chunks[n];
+        int y = n * REPLACE_CHUNK_LINES;
+        int end = y + REPLACE_CHUNK_LINES;
+        if (end > job->line_count) end = job->line_count;
+
+        BufferIter it;
+        long matches = 0;
+        buffer_iter_init(&it, job->buf, y);
+        for (; y < end; y++) {
+            matches += replace_line(w, c, y, buffer_iter_next(&it));
+        }
+        atomic_fetch_add(&job->lines_done, end - n * REPLACE_CHUNK_LINES);
+        atomic_fetch_add(&job->matches, matches);
+    }
+
+    free(w->line);
+    free(w);
+    atomic_fetch_add(&job->finished, 1);
+    return NULL;
+}
+
+// JOBS
+static int default_threads(void) {
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    return n > 0 ? (int)n : 1;
+}
+
+// Start replacing every match of `pattern` (0 threads: one per CPU). The
+// buffer must be fully loaded and stay unchanged until the job is done.
+// Returns -1 with a message in `error` if the pattern does not compile.
+int replace_start(ReplaceJob *job, Buffer *buf, const char *pattern,
+                  const char *replacement, int threads,
+                  char *error, size_t error_len) {
+    memset(job, 0, sizeof(ReplaceJob));
+    job->buf = buf;
+    job->line_count = buf->line_count;
+    job->chunk_count = (job->line_count + REPLACE_CHUNK_LINES - 1) /
+                       REPLACE_CHUNK_LINES;
+
+    if (threads <= 0) threads = default_threads();
+    if (threads > REPLACE_MAX_THREADS) threads = REPLACE_MAX_THREADS;
+    if (threads > job->chunk_count) threads = job->chunk_count;
+
+    job->regs = (regex_t *)calloc(threads, sizeof(regex_t));
+    for (int i = 0; i < threads; i++) {
+        int err = regcomp(&job->regs[i], pattern, REG_EXTENDED);
+        if (err != 0) {
+            regerror(err, &job->regs[i], error, error_len);
+            for (int k = 0; k < i; k++) regfree(&job->regs[k]);
+            free(job->regs);
+            job->regs = NULL;
+            return -1;
+        }
+    }
+    job->reg_count = threads;
+
+    job->replacement = strdup(replacement);
+    job->replacement_len = strlen(replacement);
+    job->chunks = (ReplaceChunk *)calloc(job->chunk_count,
+                                         sizeof(ReplaceChunk));
+    job->threads = (pthread_t *)calloc(threads, sizeof(pthread_t));
+
+    for (int i = 0; i < threads; i++) {
+        Worker *w = (Worker *)calloc(1, sizeof(Worker));
+        w->job = job;
+        w->reg = &job->regs[i];
+        if (pthread_create(&job->threads[i], NULL, replace_thread, w) != 0) {
+            free(w);
+            break;
+        }
+        job->thread_count++;
+    }
+
+    // Without any worker the job is done at once, having replaced nothing.
+    if (job->thread_count == 0) atomic_store(&job->cancel, 1);
+    return 0;
+}
+
+// 1 once every worker has stopped.
+int replace_done(ReplaceJob *job) {
+    return atomic_load(&job->finished) == job->thread_count;
+}
+
+// Percentage of the lines searched so far.
+int replace_progress(ReplaceJob *job) {
+    if (job->line_count == 0) return 100;
+    return (int)((long)atomic_load(&job->lines_done) * 100 / job->line_count);
+}
+
+// Ask the workers to stop after their current chunk.
+void replace_cancel(ReplaceJob *job) {
+    atomic_store(&job->cancel, 1);
+}
+
+void replace_wait(ReplaceJob *job) {
+    for (int i = 0; i < job->thread_count; i++) {
+        pthread_join(job->threads[i], NULL);
+    }
+    job->thread_count = 0;
+    atomic_store(&job->finished, 0);
+}
+
+void replace_free(ReplaceJob *job) {
+    replace_wait(job);
+    for (int i = 0; i < job->reg_count; i++) regfree(&job->regs[i]);
+    free(job->regs);
+    free(job->threads);
+    free(job->replacement);
+    for (int i = 0; i < job->chunk_count; i++) {
+        free(job->chunks[i].edits);
+        free(job->chunks[i].text);
+    }
+    free(job->chunks);
+    memset(job, 0, sizeof(ReplaceJob));
+}
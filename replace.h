@@ -0,0 +1,97 @@
+/*
+ * LIWIT - Linux-Windows Text Editor
+ * Copyright (C) 2026  Khud Bakhtiyar Iqbal Sofi
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Regex replace-all.
+ *
+ * The lines of the buffer are cut into chunks of REPLACE_CHUNK_LINES,
+ * and a pool of worker threads takes chunks off a shared counter until
+ * none are left. Each worker runs its own copy of the compiled pattern
+ * (glibc serializes regexec() calls on one regex_t) and writes, for
+ * every line that matched, the span to replace and its new text into
+ * the chunk's own result list. Nothing is changed in the buffer while
+ * the job runs: the editor applies the results once every chunk is done,
+ * or throws them away if the job was cancelled.
+ *
+ * Patterns are POSIX extended regular expressions matched one line at a
+ * time. In the replacement, & is the whole match, \1 to \9 the groups,
+ * \n a line break and \t a tab.
+ */
+
+#ifndef LIWIT_REPLACE_H
+#define LIWIT_REPLACE_H
+
+#include <stddef.h>
+#include <pthread.h>
+#include <regex.h>
+#include <stdatomic.h>
+#include "buffer.h"
+
+// CONFIGURATION
+#define REPLACE_CHUNK_LINES 8192   // Lines a worker takes at a time
+#define REPLACE_MAX_THREADS 64
+
+// DATA STRUCTURES
+typedef struct {
+    int y;                     // Line
+    int x, end_x;              // Span replaced: first to last match
+    size_t text;               // Offset of the new text in the chunk
+    size_t len;
+} ReplaceEdit;
+
+typedef struct {
+    ReplaceEdit *edits;        // In line order
+    int count;
+    int cap;
+    char *text;                // New text of every edit, back to back
+    size_t text_len;
+    size_t text_cap;
+} ReplaceChunk;
+
+typedef struct {
+    Buffer *buf;               // Read by the workers, must not change
+    char *replacement;
+    size_t replacement_len;
+    int line_count;
+
+    regex_t *regs;             // One compiled pattern per worker
+    int reg_count;
+    pthread_t *threads;
+    int thread_count;
+
+    ReplaceChunk *chunks;
+    int chunk_count;
+
+    atomic_int next_chunk;     // Next chunk to hand out
+    atomic_int lines_done;
+    atomic_long matches;
+    atomic_int finished;       // Workers that returned
+    atomic_int cancel;
+} ReplaceJob;
+
+// PROTOTYPES
+int replace_start(ReplaceJob *job, Buffer *buf, const char *pattern,
+                  const char *replacement, int threads,
+                  char *error, size_t error_len);
+int replace_done(ReplaceJob *job);
+int replace_progress(ReplaceJob *job);
+void replace_cancel(ReplaceJob *job);
+void replace_wait(ReplaceJob *job);
+void replace_free(ReplaceJob *job);
+
+#endif
@@ -0,0 +1,366 @@
+/*
+ * LIWIT - Linux-Windows Text Editor
+ * Copyright (C) 2026  Khud Bakhtiyar Iqbal Sofi
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include "search.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define HAVE_X86_SIMD 1
+#endif
+
+// SUBSTRING SEARCH
+static const char *find_memchr(const char *hay, size_t n,
+                               const char *needle, size_t m) {
+    if (m == 0 || m > n) return NULL;
+
+    const char *p = hay;
+    const char *last = hay + n - m;
+    while (p <= last) {
+        p = (const char *)memchr(p, needle[0], last - p + 1);
+        if (!p) return NULL;
+        if (memcmp(p + 1, needle + 1, m - 1) == 0) return p;
+        p++;
+    }
+    return NULL;
+}
+
+#ifdef HAVE_X86_SIMD
+// Compare the needle's first and last bytes against 16 positions at a
+// time; only positions where both match are checked with memcmp.
+static const char *find_sse2(const char *hay, size_t n,
+                             const char *needle, size_t m) {
+    if (m < 2 || m > n) return find_memchr(hay, n, needle, m);
+
+    const __m128i first = _mm_set1_epi8(needle[0]);
+    const __m128i last = _mm_set1_epi8(needle[m - 1]);
+    size_t i = 0;
+
+    for (; i + m - 1 + 16 <= n; i += 16) {
+        __m128i a = _mm_loadu_si128((const __m128i *)(hay + i));
+        __m128i b = _mm_loadu_si128((const __m128i *)(hay + i + m - 1));
+        unsigned int mask = _mm_movemask_epi8(
+            _mm_and_si128(_mm_cmpeq_epi8(a, first), _mm_cmpeq_epi8(b, last)));
+
+        while (mask) {
+            int bit = __builtin_ctz(mask);
+            if (memcmp(hay + i + bit + 1, needle + 1, m - 2) == 0) {
+                return hay + i + bit;
+            }
+            mask &= mask - 1;
+        }
+    }
+    return find_memchr(hay + i, n - i, needle, m);
+}
+
+__attribute__((target("avx2")))
+static const char *find_avx2(const char *hay, size_t n,
+                             const char *needle, size_t m) {
+    if (m < 2 || m > n) return find_memchr(hay, n, needle, m);
+
+    const __m256i first = _mm256_set1_epi8(needle[0]);
+    const __m256i last = _mm256_set1_epi8(needle[m - 1]);
+    size_t i = 0;
+
+    for (; i + m - 1 + 32 <= n; i += 32) {
+        __m256i a = _mm256_loadu_si256((const __m256i *)(hay + i));
+        __m256i b = _mm256_loadu_si256((const __m256i *)(hay + i + m - 1));
+        unsigned int mask = (unsigned int)_mm256_movemask_epi8(
+            _mm256_and_si256(_mm256_cmpeq_epi8(a, first),
+                             _mm256_cmpeq_epi8(b, last)));
+
+        while (mask) {
+            int bit = __builtin_ctz(mask);
+            if (memcmp(hay + i + bit + 1, needle + 1, m - 2) == 0) {
+                return hay + i + bit;
+            }
+            mask &= mask - 1;
+        }
+    }
+    return find_memchr(hay + i, n - i, needle, m);
+}
+#endif
+
+typedef struct {
+    const char *name;
+    const char *(*find)(const char *hay, size_t n,
+                        const char *needle, size_t m);
+} Finder;
+
+static const Finder finders[] = {
+#ifdef HAVE_X86_SIMD
+    { "avx2", find_avx2 },
+    { "sse2", find_sse2 },
+#endif
+    { "memchr", find_memchr },
+};
+
+static const Finder *finder;
+
+static int finder_supported(const Finder *f) {
+#ifdef HAVE_X86_SIMD
+    if (f->find == find_avx2) return __builtin_cpu_supports("avx2");
+    if (f->find == find_sse2) return __builtin_cpu_supports("sse2");
+#endif
+    (void)f;
+    return 1;
+}
+
+static const Finder *finder_pick(void) {
+    if (!finder) {
+        int n = sizeof(finders) / sizeof(finders[0]);
+        for (int i = 0; i < n && !finder; i++) {
+            if (finder_supported(&finders[i])) finder = &finders[i];
+        }
+    }
+    return finder;
+}
+
+const char *search_memmem(const char *hay, size_t n,
+                          const char *needle, size_t m) {
+    return finder_pick()->find(hay, n, needle, m);
+}
+
+const char *search_scanner(void) {
+    return finder_pick()->name;
+}
+
+// Force an implementation by name (for benchmarks). Returns -1 if
+// unavailable.
+int search_use_scanner(const char *name) {
+    int n = sizeof(finders) / sizeof(finders[0]);
+    for (int i = 0; i < n; i++) {
+        if (strcmp(finders[i].name, name) == 0 &&
+            finder_supported(&finders[i])) {
+            finder = &finders[i];
+            return 0;
+        }
+    }
+    return -1;
+}
+
+// Column of the first match at or after column `from`, or -1.
+int search_line(SearchIndex *s, Line line, int from) {
+    if (from < 0) from = 0;
+    if (line.len - from < (int)s->len) return -1;
+    const char *p = search_memmem(line.text + from, line.len - from,
+                                  s->query, s->len);
+    return p ? (int)(p - line.text) : -1;
+}
+
+// INITIALIZATION & CLEANUP
+void search_init(SearchIndex *s) {
+    memset(s, 0, sizeof(SearchIndex));
+}
+
+void search_free(SearchIndex *s) {
+    free(s->query);
+    free(s->hits);
+    memset(s, 0, sizeof(SearchIndex));
+}
+
+static void index_reset(SearchIndex *s, Buffer *buf) {
+    s->hit_count = 0;
+    s->scanned = 0;
+    s->full = 0;
+    s->none = 0;
+    s->version = buf->version;
+}
+
+// Forget the matches if the text changed since they were found.
+static void index_check(SearchIndex *s, Buffer *buf) {
+    if (s->version != buf->version) index_reset(s, buf);
+}
+
+void search_set_query(SearchIndex *s, Buffer *buf,
+                      const char *query, size_t len) {
+    // Typing more of a query that does not occur cannot make it occur.
+    int none = s->none && s->version == buf->version &&
+               len >= s->len && memcmp(query, s->query, s->len) == 0;
+
+    char *copy = (char *)malloc(len + 1);
+    memcpy(copy, query, len);
+    copy[len] = '\0';
+    free(s->query);
+    s->query = copy;
+    s->len = len;
+
+    index_reset(s, buf);
+    s->none = none;
+}
+
+// MATCH INDEX
+// Index about `budget` bytes of lines past s->scanned. Returns 1 while
+// there is more to index.
+int search_step(SearchIndex *s, Buffer *buf, size_t budget) {
+    index_check(s, buf);
+    if (s->len == 0 || s->full || s->none) return 0;
+
+    BufferIter it;
+    size_t done = 0;
+    buffer_iter_init(&it, buf, s->scanned);
+
+    while (s->scanned < buf->line_count && done < budget) {
+        Line line = buffer_iter_next(&it);
+        int kept = s->hit_count;
+
+        for (int x = search_line(s, line, 0); x >= 0; x = search_line(s, line, x + 1)) {
+            if (s->hit_count == SEARCH_MAX_HITS) {
+                s->hit_count = kept;
+                s->full = 1;
+                return 0;
+            }
+            if (s->hit_count == s->hit_cap) {
+                s->hit_cap = s->hit_cap ? s->hit_cap * 2 : 1024;
+                s->hits = (SearchHit *)realloc(s->hits,
+                                               s->hit_cap * sizeof(SearchHit));
+            }
+            s->hits[s->hit_count].y = s->scanned;
+            s->hits[s->hit_count].x = x;
+            s->hit_count++;
+        }
+        done += line.len + 1;
+        s->scanned++;
+    }
+
+    if (s->scanned == buf->line_count && s->hit_count == 0 &&
+        !buffer_loading(buf)) {
+        s->none = 1;
+    }
+    return s->scanned < buf->line_count;
+}
+
+// 1 once every match is in the index.
+int search_complete(SearchIndex *s, Buffer *buf) {
+    index_check(s, buf);
+    return s->none || (!s->full && s->scanned >= buf->line_count &&
+                       !buffer_loading(buf));
+}
+
+// First indexed hit at or after (y, x).
+static int lower_bound(SearchIndex *s, int y, int x) {
+    int lo = 0;
+    int hi = s->hit_count;
+    while (lo < hi) {
+        int mid = lo + (hi - lo) / 2;
+        SearchHit *h = &s->hits[mid];
+        if (h->y < y || (h->y == y && h->x < x)) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo;
+}
+
+// Position of a hit among all matches (1-based), 0 if not indexed yet.
+int search_rank(SearchIndex *s, SearchHit hit) {
+    if (hit.y >= s->scanned) return 0;
+    int i = lower_bound(s, hit.y, hit.x);
+    if (i < s->hit_count && s->hits[i].y == hit.y && s->hits[i].x == hit.x) {
+        return i + 1;
+    }
+    return 0;
+}
+
+// LOOKUP
+// First match at or after (y, x) in lines before y_end: a binary search
+// where the index reaches, a scan of the lines beyond it.
+static int first_from(SearchIndex *s, Buffer *buf, int y, int x, int y_end,
+                      SearchHit *hit) {
+    if (y < s->scanned) {
+        int i = lower_bound(s, y, x);
+        if (i < s->hit_count && s->hits[i].y < y_end) {
+            *hit = s->hits[i];
+            return 1;
+        }
+        if (s->scanned >= y_end) return 0;
+        y = s->scanned;
+        x = 0;
+    }
+
+    BufferIter it;
+    buffer_iter_init(&it, buf, y);
+    for (; y < y_end; y++, x = 0) {
+        int col = search_line(s, buffer_iter_next(&it), x);
+        if (col >= 0) {
+            hit->y = y;
+            hit->x = col;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// Last match before (y, x) in lines from y_start on.
+static int last_before(SearchIndex *s, Buffer *buf, int y, int x,
+                       int y_start, SearchHit *hit) {
+    if (y >= s->scanned) {
+        int stop = s->scanned > y_start ? s->scanned : y_start;
+        for (; y >= stop; y--, x = INT_MAX) {
+            Line line = buffer_line(buf, y);
+            int found = -1;
+            for (int col = search_line(s, line, 0); col >= 0 && col < x;
+                 col = search_line(s, line, col + 1)) {
+                found = col;
+            }
+            if (found >= 0) {
+                hit->y = y;
+                hit->x = found;
+                return 1;
+            }
+        }
+        if (s->scanned <= y_start) return 0;
+        y = s->scanned;
+        x = 0;
+    }
+
+    int i = lower_bound(s, y, x) - 1;
+    if (i >= 0 && s->hits[i].y >= y_start) {
+        *hit = s->hits[i];
+        return 1;
+    }
+    return 0;
+}
+
+// Next match after (y, x), or at it if `inclusive`, wrapping around the
+// end of the file. Returns 0 if the query does not occur.
+int search_next(SearchIndex *s, Buffer *buf, int y, int x, int inclusive,
+                SearchHit *hit) {
+    index_check(s, buf);
+    if (s->len == 0 || s->none) return 0;
+
+    if (first_from(s, buf, y, inclusive ? x : x + 1, buf->line_count, hit) ||
+        first_from(s, buf, 0, 0, y + 1, hit)) {
+        return 1;
+    }
+    if (!buffer_loading(buf)) s->none = 1;
+    return 0;
+}
+
+// Previous match before (y, x), wrapping around the top of the file.
+int search_prev(SearchIndex *s, Buffer *buf, int y, int x, SearchHit *hit) {
+    index_check(s, buf);
+    if (s->len == 0 || s->none) return 0;
+
+    if (last_before(s, buf, y, x, 0, hit) ||
+        last_before(s, buf, buf->line_count - 1, INT_MAX, y, hit)) {
+        return 1;
+    }
+    if (!buffer_loading(buf)) s->none = 1;
+    return 0;
+}
@@ -0,0 +1,81 @@
+/*
+ * LIWIT - Linux-Windows Text Editor
+ * Copyright (C) 2026  Khud Bakhtiyar Iqbal Sofi
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Text search.
+ *
+ * search_memmem() finds a string by comparing its first and last bytes
+ * against 16 or 32 positions at once (SSE2 or AVX2, picked at run time)
+ * and checking only the candidates where both match.
+ *
+ * A SearchIndex holds the positions of every match of one query, built
+ * a slice at a time from the top of the file by search_step() while the
+ * editor is idle. Next/previous lookups inside the indexed part are
+ * binary searches; past it they fall back to scanning the lines. Any
+ * change to the buffer throws the index away.
+ */
+
+#ifndef LIWIT_SEARCH_H
+#define LIWIT_SEARCH_H
+
+#include <stddef.h>
+#include "buffer.h"
+
+// CONFIGURATION
+#define SEARCH_SLICE_BYTES (8 << 20)   // Text indexed per search_step()
+#define SEARCH_MAX_HITS (1 << 22)      // Stop indexing after this many
+
+// DATA STRUCTURES
+typedef struct {
+    int y;
+    int x;
+} SearchHit;
+
+typedef struct {
+    char *query;
+    size_t len;
+
+    SearchHit *hits;           // Matches in lines [0, scanned), in order
+    int hit_count;
+    int hit_cap;
+    int scanned;               // Lines indexed so far
+    int full;                  // 1 once SEARCH_MAX_HITS was reached
+    int none;                  // 1 if the query is known not to occur
+    unsigned long version;     // Buffer version the hits belong to
+} SearchIndex;
+
+// PROTOTYPES
+const char *search_memmem(const char *hay, size_t n,
+                          const char *needle, size_t m);
+const char *search_scanner(void);
+int search_use_scanner(const char *name);
+
+void search_init(SearchIndex *s);
+void search_free(SearchIndex *s);
+void search_set_query(SearchIndex *s, Buffer *buf,
+                      const char *query, size_t len);
+
+int search_line(SearchIndex *s, Line line, int from);
+int search_step(SearchIndex *s, Buffer *buf, size_t budget);
+int search_complete(SearchIndex *s, Buffer *buf);
+int search_next(SearchIndex *s, Buffer *buf, int y, int x, int inclusive,
+                SearchHit *hit);
+int search_prev(SearchIndex *s, Buffer *buf, int y, int x, SearchHit *hit);
+int search_rank(SearchIndex *s, SearchHit hit);
+
+#endif
@@ -0,0 +1,377 @@
+/*
+ * LIWIT - Linux-Windows Text Editor
+ * Copyright (C) 2026  Khud Bakhtiyar Iqbal Sofi
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <limits.h>
+#include "syntax.h"
+
+// Lexer states carried from one line to the next
+#define STATE_NORMAL 0
+#define STATE_COMMENT 1            // Inside a block comment
+#define STATE_STRING 2             // + index of the quote in lang->quotes
+
+// LANGUAGES
+static const char *const c_extensions[] = {
+    ".c", ".h", ".cc", ".cpp", ".cxx", ".hh", ".hpp", NULL
+};
+static const char *const c_keywords[] = {
+    "auto", "break", "case", "const", "continue", "default", "do", "else",
+    "enum", "extern", "for", "goto", "if", "inline", "register", "restrict",
+    "return", "sizeof", "static", "struct", "switch", "typedef", "union",
+    "volatile", "while", "class", "namespace", "template", "typename",
+    "public", "private", "protected", "virtual", "new", "delete", "this",
+    "NULL", "true", "false", "nullptr", NULL
+};
+static const char *const c_types[] = {
+    "void", "char", "short", "int", "long", "float", "double", "signed",
+    "unsigned", "bool", "size_t", "ssize_t", "off_t", "int8_t", "int16_t",
+    "int32_t", "int64_t", "uint8_t", "uint16_t", "uint32_t", "uint64_t",
+    "intptr_t", "uintptr_t", "FILE", NULL
+};
+static const char *const c_comments[] = { "//", NULL };
+
+static const char *const sh_extensions[] = {
+    ".sh", ".bash", ".zsh", ".bashrc", ".profile", NULL
+};
+static const char *const sh_keywords[] = {
+    "if", "then", "else", "elif", "fi", "for", "while", "until", "do",
+    "done", "case", "esac", "in", "function", "select", "return", "exit",
+    "break", "continue", "local", "export", "readonly", "declare", "unset",
+    "shift", "source", NULL
+};
+static const char *const hash_comments[] = { "#", NULL };
+
+static const char *const json_extensions[] = { ".json", NULL };
+static const char *const json_keywords[] = { "true", "false", "null", NULL };
+
+static const char *const yaml_extensions[] = { ".yaml", ".yml", NULL };
+static const char *const yaml_keywords[] = {
+    "true", "false", "null", "yes", "no", "on", "off", NULL
+};
+
+static const char *const ini_extensions[] = { ".ini", ".cfg", ".conf", NULL };
+static const char *const ini_comments[] = { ";", "#", NULL };
+
+static const SyntaxLang languages[] = {
+    { "C", c_extensions, c_keywords, c_types, c_comments, "/*", "*/",
+      "\"'", 0, SYN_NUMBERS | SYN_PREPROC },
+    { "Shell", sh_extensions, sh_keywords, NULL, hash_comments, NULL, NULL,
+      "\"'", 0, SYN_NUMBERS | SYN_VARS | SYN_MULTILINE | SYN_WORD_COMMENT },
+    { "JSON", json_extensions, json_keywords, NULL, NULL, NULL, NULL,
+      "\"", 0, SYN_NUMBERS | SYN_STRING_KEYS },
+    { "YAML", yaml_extensions, yaml_keywords, NULL, hash_comments, NULL, NULL,
+      "\"'", ':', SYN_NUMBERS | SYN_LINE_KEYS | SYN_WORD_COMMENT },
+    { "INI", ini_extensions, NULL, NULL, ini_comments, NULL, NULL,
+      "\"", '=', SYN_NUMBERS | SYN_LINE_KEYS | SYN_SECTIONS |
+                 SYN_WORD_COMMENT },
+};
+
+#define LANGUAGE_COUNT (int)(sizeof(languages) / sizeof(languages[0]))
+
+// INITIALIZATION & CLEANUP
+void syntax_init(Syntax *syn) {
+    memset(syn, 0, sizeof(Syntax));
+}
+
+void syntax_free(Syntax *syn) {
+    free(syn->hl);
+    memset(syn, 0, sizeof(Syntax));
+}
+
+static int ends_with(const char *s, const char *suffix) {
+    size_t n = strlen(s);
+    size_t m = strlen(suffix);
+    return n >= m && strcmp(s + n - m, suffix) == 0;
+}
+
+// Pick the language from the file name, or from a "#!" line naming a
+// shell.
+void syntax_select(Syntax *syn, const char *filename, Line first_line) {
+    syn->lang = NULL;
+    for (int i = 0; filename && i < LANGUAGE_COUNT && !syn->lang; i++) {
+        for (const char *const *ext = languages[i].extensions; *ext; ext++) {
+            if (ends_with(filename, *ext)) {
+                syn->lang = &languages[i];
+                break;
+            }
+        }
+    }
+
+    if (!syn->lang && first_line.len > 2 &&
+        memcmp(first_line.text, "#!", 2) == 0 &&
+        memchr(first_line.text, 's', first_line.len) &&
+        first_line.text[first_line.len - 1] == 'h') {
+        syn->lang = &languages[1];
+    }
+}
+
+// LEXER
+static int is_word(unsigned char c) {
+    return isalnum(c) || c == '_';
+}
+
+static int starts_at(const char *text, int len, int i, const char *s) {
+    if (text[i] != s[0]) return 0;
+    int n = (int)strlen(s);
+    return i + n <= len && memcmp(text + i, s, n) == 0;
+}
+
+static int in_list(const char *const *list, const char *word, int n) {
+    for (; list && *list; list++) {
+        if ((int)strlen(*list) == n && memcmp(*list, word, n) == 0) return 1;
+    }
+    return 0;
+}
+
+static void mark(unsigned char *hl, int from, int to, int cls) {
+    if (hl && to > from) memset(hl + from, cls, to - from);
+}
+
+// End of a "key" at the start of a line: the first separator that is not
+// inside quotes (for ':' it must be followed by a blank), or -1.
+static int line_key_end(const SyntaxLang *lang, const char *text, int len,
+                        int i) {
+    for (; i < len; i++) {
+        char c = text[i];
+        if (strchr(lang->quotes, c) || c == '#' || c == ';') return -1;
+        if (c == lang->key_sep &&
+            (c != ':' || i + 1 == len || text[i + 1] == ' ' ||
+             text[i + 1] == '\t')) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+// Lex one line starting in `state`. Fills hl (if not NULL) with a class
+// per byte and returns the state the next line starts in.
+int syntax_line(const SyntaxLang *lang, int state, const char *text, int len,
+                unsigned char *hl) {
+    int flags = lang->flags;
+    int base = HL_NORMAL;
+    int i = 0;
+    int str_start = 0;
+
+    int indent = 0;
+    while (indent < len && (text[indent] == ' ' || text[indent] == '\t')) {
+        indent++;
+    }
+
+    if (state == STATE_NORMAL && indent < len) {
+        if ((flags & SYN_SECTIONS) && text[indent] == '[') {
+            mark(hl, 0, len, HL_SECTION);
+            return STATE_NORMAL;
+        }
+        if ((flags & SYN_PREPROC) && text[indent] == '#') base = HL_PREPROC;
+    }
+    mark(hl, 0, len, base);
+
+    if (state == STATE_NORMAL && (flags & SYN_LINE_KEYS)) {
+        int k = indent;
+        if (lang->key_sep == ':' && k + 1 < len &&
+            text[k] == '-' && text[k + 1] == ' ') {
+            k += 2;  // YAML list item
+        }
+        int end = line_key_end(lang, text, len, k);
+        if (end > k) {
+            mark(hl, k, end, HL_KEY);
+            i = end;
+        }
+    }
+
+    while (i < len) {
+        if (state == STATE_COMMENT) {
+            int start = i;
+            while (i < len && !starts_at(text, len, i, lang->block_end)) i++;
+            if (i == len) {
+                mark(hl, start, len, HL_COMMENT);
+                return STATE_COMMENT;
+            }
+            i += (int)strlen(lang->block_end);
+            mark(hl, start, i, HL_COMMENT);
+            state = STATE_NORMAL;
+            continue;
+        }
+
+        if (state >= STATE_STRING) {
+            char quote = lang->quotes[state - STATE_STRING];
+            int start = i;
+            while (i < len && text[i] != quote) {
+                if (text[i] == '\\' && i + 1 < len) i++;
+                i++;
+            }
+            if (i == len) {
+                mark(hl, start, len, HL_STRING);
+                return (flags & SYN_MULTILINE) ? state : STATE_NORMAL;
+            }
+            i++;
+            mark(hl, start, i, HL_STRING);
+            state = STATE_NORMAL;
+
+            if (flags & SYN_STRING_KEYS) {
+                int j = i;
+                while (j < len && (text[j] == ' ' || text[j] == '\t')) j++;
+                if (j < len && text[j] == ':') mark(hl, str_start, i, HL_KEY);
+            }
+            continue;
+        }
+
+        unsigned char c = text[i];
+        int word_start = i == 0 || !is_word(text[i - 1]);
+
+        int comment = 0;
+        for (const char *const *lc = lang->line_comments; lc && *lc; lc++) {
+            if (starts_at(text, len, i, *lc) &&
+                (!(flags & SYN_WORD_COMMENT) || i == 0 ||
+                 isspace((unsigned char)text[i - 1]))) {
+                comment = 1;
+            }
+        }
+        if (comment) {
+            mark(hl, i, len, HL_COMMENT);
+            return STATE_NORMAL;
+        }
+
+        if (lang->block_start && starts_at(text, len, i, lang->block_start)) {
+            int n = (int)strlen(lang->block_start);
+            mark(hl, i, i + n, HL_COMMENT);
+            i += n;
+            state = STATE_COMMENT;
+            continue;
+        }
+
+        const char *quote = c ? strchr(lang->quotes, c) : NULL;
+        if (quote) {
+            str_start = i;
+            mark(hl, i, i + 1, HL_STRING);
+            i++;
+            state = STATE_STRING + (int)(quote - lang->quotes);
+            continue;
+        }
+
+        if ((flags & SYN_VARS) && c == '$' && i + 1 < len) {
+            int j = i + 1;
+            if (text[j] == '{') {
+                while (j < len && text[j] != '}') j++;
+                if (j < len) j++;
+            } else if (is_word(text[j])) {
+                while (j < len && is_word(text[j])) j++;
+            } else {
+                j++;  // $?, $#, $@ ...
+            }
+            mark(hl, i, j, HL_VARIABLE);
+            i = j;
+            continue;
+        }
+
+        if ((flags & SYN_NUMBERS) && word_start && isdigit(c)) {
+            int j = i;
+            while (j < len && (is_word(text[j]) || text[j] == '.')) j++;
+            mark(hl, i, j, HL_NUMBER);
+            i = j;
+            continue;
+        }
+
+        if (word_start && (isalpha(c) || c == '_')) {
+            int j = i;
+            while (j < len && is_word(text[j])) j++;
+            if (hl) {
+                if (in_list(lang->keywords, text + i, j - i)) {
+                    mark(hl, i, j, HL_KEYWORD);
+                } else if (in_list(lang->types, text + i, j - i)) {
+                    mark(hl, i, j, HL_TYPE);
+                }
+            }
+            i = j;
+            continue;
+        }
+        i++;
+    }
+
+    if (state >= STATE_STRING && !(flags & SYN_MULTILINE)) return STATE_NORMAL;
+    return state;
+}
+
+// STATE CACHE
+// Lexer state at the start of line y. The lexer starts from the nearest
+// block whose cached state is known and not past a change, and caches
+// the state of every block it enters on the way to y.
+int syntax_state_at(Syntax *syn, Buffer *buf, int y) {
+    const SyntaxLang *lang = syn->lang;
+    if (!lang || y == 0) return STATE_NORMAL;
+
+restart:;
+    int off;
+    int k = buffer_locate(buf, y, &off);
+    int first = y - off;
+
+    // Too far back means lexing half the file for one screen; guess that
+    // the text there starts outside any comment or string instead.
+    while (k > 0 && (buffer_block(buf, k)->syntax < 0 ||
+                     first > buf->changed_from) &&
+           y - first < SYNTAX_MAX_SCAN) {
+        k--;
+        first -= buffer_block(buf, k)->count;
+    }
+    int state = STATE_NORMAL;
+    LineBlock *start = buffer_block(buf, k);
+    if (k > 0 && start->syntax >= 0 && first <= buf->changed_from) {
+        state = start->syntax;
+    }
+
+    BufferIter it;
+    buffer_iter_init(&it, buf, first);
+    int block_end = first + start->count;
+
+    for (int line = first; line < y; ) {
+        Line l = buffer_iter_next(&it);
+        state = syntax_line(lang, state, l.text, l.len, NULL);
+        line++;
+        if (line < block_end) continue;
+
+        LineBlock *blk = buffer_block(buf, ++k);
+        block_end += blk->count;
+
+        // Past the last change and in step with the cache again: the rest
+        // of the cache is good, and the walk can start over from it.
+        if (line > buf->changed_to && blk->syntax == state) {
+            buf->changed_from = INT_MAX;
+            buf->changed_to = -1;
+            if (line < y) goto restart;
+            break;
+        }
+        blk->syntax = state;
+        if (line > buf->changed_from) {
+            buf->changed_from = line;
+            if (line > buf->changed_to) buf->changed_to = line;
+        }
+    }
+    return state;
+}
+
+// Classes of one line starting in `state`, valid until the next call.
+const unsigned char *syntax_highlight(Syntax *syn, int state, Line line) {
+    if (line.len > syn->hl_cap) {
+        syn->hl_cap = line.len > 256 ? line.len : 256;
+        syn->hl = (unsigned char *)realloc(syn->hl, syn->hl_cap);
+    }
+    syntax_line(syn->lang, state, line.text, line.len, syn->hl);
+    return syn->hl;
+}
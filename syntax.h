@@ -0,0 +1,96 @@
+/*
+ * LIWIT - Linux-Windows Text Editor
+ * Copyright (C) 2026  Khud Bakhtiyar Iqbal Sofi
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Syntax highlighting.
+ *
+ * Each language is one row of a table: its keywords, comment and string
+ * delimiters and a few flags. One lexer reads a line with any of them,
+ * starting from the state the previous line ended in (inside a block
+ * comment or a string, or neither).
+ *
+ * The state at the first line of every block of the buffer is cached in
+ * the block itself, so it moves with the text as lines come and go. The
+ * buffer records which lines changed since the cache last caught up;
+ * from there, lines are lexed again only as far as they are needed, and
+ * once the state at a block past the changes matches the cached one the
+ * rest of the file is known to be unchanged. Only visible rows are ever
+ * highlighted.
+ */
+
+#ifndef LIWIT_SYNTAX_H
+#define LIWIT_SYNTAX_H
+
+#include "buffer.h"
+
+// CONFIGURATION
+#define SYNTAX_MAX_SCAN 20000      // Lines lexed to find a state, at most
+
+// Highlight classes
+#define HL_NORMAL 0
+#define HL_COMMENT 1
+#define HL_KEYWORD 2
+#define HL_TYPE 3
+#define HL_STRING 4
+#define HL_NUMBER 5
+#define HL_PREPROC 6
+#define HL_KEY 7
+#define HL_SECTION 8
+#define HL_VARIABLE 9
+
+// Language flags
+#define SYN_NUMBERS (1 << 0)       // Highlight numbers
+#define SYN_PREPROC (1 << 1)       // '#' starting a line is a directive
+#define SYN_VARS (1 << 2)          // $name and ${name}
+#define SYN_MULTILINE (1 << 3)     // Strings may span lines
+#define SYN_WORD_COMMENT (1 << 4)  // Line comments must start a word
+#define SYN_STRING_KEYS (1 << 5)   // "key": ...
+#define SYN_LINE_KEYS (1 << 6)     // key: ... / key = ... at line start
+#define SYN_SECTIONS (1 << 7)      // [section] lines
+
+// DATA STRUCTURES
+typedef struct {
+    const char *name;
+    const char *const *extensions;   // File name endings, NULL-terminated
+    const char *const *keywords;
+    const char *const *types;
+    const char *const *line_comments;
+    const char *block_start;         // Block comment delimiters, or NULL
+    const char *block_end;
+    const char *quotes;              // String delimiters
+    char key_sep;                    // For SYN_LINE_KEYS
+    int flags;
+} SyntaxLang;
+
+typedef struct {
+    const SyntaxLang *lang;    // NULL for plain text
+    unsigned char *hl;         // Classes of the last highlighted line
+    int hl_cap;
+} Syntax;
+
+// PROTOTYPES
+void syntax_init(Syntax *syn);
+void syntax_free(Syntax *syn);
+void syntax_select(Syntax *syn, const char *filename, Line first_line);
+
+int syntax_line(const SyntaxLang *lang, int state, const char *text, int len,
+                unsigned char *hl);
+int syntax_state_at(Syntax *syn, Buffer *buf, int y);
+const unsigned char *syntax_highlight(Syntax *syn, int state, Line line);
+
+#endif
@@ -0,0 +1,82 @@
+/*
+ * Line insertion micro-benchmark.
+ *
+ * Opens a 1M-line file and holds Enter at line 1, then Backspace to
+ * join the new lines back up, then cuts half the file in one go. Each
+ * keystroke is timed on its own; the worst one is what a user would
+ * notice.
+ *
+ *   make bench
+ *   ./tests/bench_enter [lines] [keys]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "buffer.h"
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void make_file(const char *path, long lines) {
+    FILE *f = fopen(path, "w");
+    for (long i = 0; i < lines; i++) {
+        fprintf(f, "line %ld of the benchmark file\n", i);
+    }
+    fclose(f);
+}
+
+static void report(const char *name, double total, double worst, int keys) {
+    printf("  %-10s %7d keys  %8.1f ms  %7.0f ns/key  worst %7.1f us\n",
+           name, keys, total * 1000, total / keys * 1e9, worst * 1e6);
+}
+
+int main(int argc, char *argv[]) {
+    long lines = argc > 1 ? atol(argv[1]) : 1000000;
+    int keys = argc > 2 ? atoi(argv[2]) : 100000;
+    const char *path = "/tmp/liwit_bench_enter.txt";
+    make_file(path, lines);
+
+    Buffer buf;
+    buffer_open(&buf, path);
+    buffer_finish(&buf);
+    printf("%d lines:\n", buf.line_count);
+
+    // Enter at the start of line 1; the cursor moves down each time.
+    double total = 0, worst = 0;
+    for (int i = 0; i < keys; i++) {
+        int end_y, end_x;
+        double t0 = now();
+        buffer_insert(&buf, i, 0, "\n", 1, &end_y, &end_x);
+        double t = now() - t0;
+        total += t;
+        if (t > worst) worst = t;
+    }
+    report("Enter", total, worst, keys);
+
+    // Backspace at the start of each new line, back up to line 1.
+    total = worst = 0;
+    for (int i = keys; i > 0; i--) {
+        double t0 = now();
+        buffer_delete_range(&buf, i - 1, 0, i, 0);
+        double t = now() - t0;
+        total += t;
+        if (t > worst) worst = t;
+    }
+    report("Backspace", total, worst, keys);
+
+    // Cut the first half of the file as one selection.
+    double t0 = now();
+    buffer_delete_range(&buf, 0, 0, buf.line_count / 2, 0);
+    printf("  cut of %d lines  %.2f ms\n", (int)(lines / 2),
+           (now() - t0) * 1000);
+
+    buffer_free(&buf);
+    unlink(path);
+    return 0;
+}
@@ -0,0 +1,120 @@
+/*
+ * Follow mode benchmark.
+ *
+ * Appends to a log the way a busy writer does, in pieces that end in the
+ * middle of a line, and takes each piece in with buffer_grow() as the
+ * editor's poll does (every 50 ms at the given rate). Reports how long
+ * the polls take, the rate the buffer keeps up with, and checks every
+ * line against what was written. Then checks that a last line the
+ * buffer already keeps a record of, as an edit nearby makes it, gets
+ * longer too.
+ *
+ *   make bench
+ *   ./tests/bench_follow [MB/s] [seconds of log]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "buffer.h"
+
+#define POLL_MS 50
+#define BUDGET (16 << 20)
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static int log_line(char *out, long i) {
+    return sprintf(out, "2026-10-16 12:00:%02ld.%06ld INFO request %ld "
+                   "served in %ld us\n", i / 100000 % 60, i % 1000000, i,
+                   i * 7919 % 100000);
+}
+
+// Append to an unfinished last line after an edit to the line before.
+static int check_edited_tail(const char *path) {
+    static const char *expect[] = {"> first", "second", "third"};
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (write(fd, "first\nsec", 9) != 9) return 1;
+
+    Buffer buf;
+    buffer_open_growing(&buf, path);
+    int y, x;
+    buffer_insert(&buf, 0, 0, "> ", 2, &y, &x);
+    if (write(fd, "ond\nthird", 9) != 9) return 1;
+    close(fd);
+    while (buffer_grow(&buf, BUDGET) > 0 && buffer_growing(&buf)) {}
+
+    int bad = buf.line_count != 3;
+    for (int i = 0; i < 3 && !bad; i++) {
+        Line line = buffer_line(&buf, i);
+        int n = (int)strlen(expect[i]);
+        bad = line.len != n || memcmp(line.text, expect[i], n) != 0;
+    }
+    printf("  edited tail %s\n", bad ? "WRONG" : "match");
+    buffer_free(&buf);
+    return bad;
+}
+
+int main(int argc, char *argv[]) {
+    double rate = argc > 1 ? atof(argv[1]) : 50;
+    double seconds = argc > 2 ? atof(argv[2]) : 10;
+    const char *path = "/tmp/liwit_bench_follow.log";
+    size_t piece = (size_t)(rate * 1e6 * POLL_MS / 1000);
+    size_t total = (size_t)(rate * 1e6 * seconds);
+
+    // The whole log up front, so the writer is not what is measured.
+    char *text = (char *)malloc(total + 128);
+    size_t len = 0;
+    long lines = 0;
+    while (len < total) len += log_line(text + len, lines++);
+
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    Buffer buf;
+    buffer_open_growing(&buf, path);
+
+    double busy = 0, worst = 0;
+    int polls = 0;
+    for (size_t at = 0; at < len; at += piece) {
+        size_t n = len - at < piece ? len - at : piece;
+        if (write(fd, text + at, n) != (ssize_t)n) return 1;
+
+        double t0 = now();
+        while (buffer_grow(&buf, BUDGET) > 0 && buffer_growing(&buf)) {}
+        double t = now() - t0;
+        busy += t;
+        if (t > worst) worst = t;
+        polls++;
+    }
+    close(fd);
+
+    printf("%.0f MB of log at %.0f MB/s, %d polls of %zu KB:\n",
+           len / 1e6, rate, polls, piece >> 10);
+    printf("  poll       avg %7.2f ms  worst %7.2f ms  (%.1f%% of the time)\n",
+           busy / polls * 1000, worst * 1000,
+           busy / (polls * POLL_MS / 1000.0) * 100);
+    printf("  keeps up with %.0f MB/s\n", len / 1e6 / busy);
+
+    // Every line, including the ones that arrived in two pieces.
+    int bad = buf.line_count != lines;
+    char expect[128];
+    BufferIter it;
+    buffer_iter_init(&it, &buf, 0);
+    for (long i = 0; i < lines && !bad; i++) {
+        int n = log_line(expect, i) - 1;
+        Line line = buffer_iter_next(&it);
+        bad = line.len != n || memcmp(line.text, expect, n) != 0;
+    }
+    printf("  %d lines %s\n", buf.line_count, bad ? "WRONG" : "match");
+
+    buffer_free(&buf);
+    free(text);
+    bad |= check_edited_tail(path);
+    unlink(path);
+    return bad;
+}
@@ -0,0 +1,76 @@
+/*
+ * Line index micro-benchmark.
+ *
+ * Builds a synthetic file image (256 MB by default, LF and CRLF flavours)
+ * and reports how fast each available newline scanner indexes it.
+ *
+ *   make bench
+ *   ./tests/bench_lineindex [size_mb]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "lineindex.h"
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// Lines of 0..159 printable bytes, like a mix of code and log output.
+static char *make_image(size_t size, int crlf) {
+    char *data = (char *)malloc(size);
+    unsigned int seed = 12345;
+    size_t pos = 0;
+
+    while (pos < size) {
+        seed = seed * 1103515245 + 12345;
+        size_t len = (seed >> 16) % 160;
+        for (size_t i = 0; i < len && pos < size; i++) {
+            data[pos++] = 'a' + (i * 7 + len) % 26;
+        }
+        if (crlf && pos < size) data[pos++] = '\r';
+        if (pos < size) data[pos++] = '\n';
+    }
+    return data;
+}
+
+static void bench(const char *name, const char *data, size_t size) {
+    if (lineindex_use_scanner(name) != 0) {
+        printf("  %-8s  (not supported on this CPU)\n", name);
+        return;
+    }
+
+    double best = 1e9;
+    int lines = 0;
+    for (int run = 0; run < 3; run++) {
+        double t0 = now();
+        LineIndex *idx = lineindex_create(data, size, 0);
+        double t = now() - t0;
+        lines = lineindex_count(idx);
+        lineindex_free(idx);
+        if (t < best) best = t;
+    }
+
+    printf("  %-8s  %10d lines  %8.1f ms  %6.2f GB/s\n",
+           name, lines, best * 1000, size / best / 1e9);
+}
+
+int main(int argc, char *argv[]) {
+    size_t size_mb = argc > 1 ? strtoul(argv[1], NULL, 10) : 256;
+    size_t size = size_mb << 20;
+    const char *names[] = { "avx2", "sse2", "memchr" };
+
+    for (int crlf = 0; crlf <= 1; crlf++) {
+        char *data = make_image(size, crlf);
+        printf("%zu MB, %s line endings:\n", size_mb, crlf ? "CRLF" : "LF");
+        for (int i = 0; i < 3; i++) {
+            bench(names[i], data, size);
+        }
+        free(data);
+    }
+    return 0;
+}
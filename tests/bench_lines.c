@@ -0,0 +1,112 @@
+/*
+ * Line editing micro-benchmark.
+ *
+ * Types into a long line (1 MB by default), at its end and in its middle,
+ * and copies selections of whole lines the way Ctrl+C does, next to the
+ * strcat() loop the editor used to build them with.
+ *
+ *   make bench
+ *   ./tests/bench_lines [line_kb]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "buffer.h"
+
+#define KEYS 100000
+#define STRCAT_MAX_LINES 20000     // The old loop is quadratic; stop here
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void fill(Buffer *buf, int lines, int len) {
+    size_t size = (size_t)lines * (len + 1);
+    char *text = (char *)malloc(size);
+    for (size_t i = 0; i < size; i++) {
+        text[i] = (i % (len + 1) == (size_t)len) ? '\n' : 'a' + i % 26;
+    }
+    int end_y, end_x;
+    buffer_insert(buf, 0, 0, text, size - 1, &end_y, &end_x);
+    free(text);
+}
+
+static void bench_typing(int line_len, int middle) {
+    Buffer buf;
+    buffer_init(&buf);
+    fill(&buf, 1, line_len);
+
+    double t0 = now();
+    for (int i = 0; i < KEYS; i++) {
+        int x = middle ? line_len / 2 : buffer_line(&buf, 0).len;
+        int end_y, end_x;
+        buffer_insert(&buf, 0, x, "x", 1, &end_y, &end_x);
+    }
+    double t = now() - t0;
+
+    printf("  typing at the %-6s  %8.1f ms  %8.0f ns/key\n",
+           middle ? "middle" : "end", t * 1000, t / KEYS * 1e9);
+    buffer_free(&buf);
+}
+
+// What copy_selection() did before: grow the result with strncat/strcat,
+// each of which walks the whole string built so far.
+static char *copy_strcat(Buffer *buf, int start, int end) {
+    size_t buf_size = 0;
+    for (int i = start; i <= end; i++) {
+        buf_size += buffer_line(buf, i).len + 1;
+    }
+    char *text = (char *)malloc(buf_size + 1);
+    text[0] = '\0';
+
+    for (int i = start; i <= end; i++) {
+        Line line = buffer_line(buf, i);
+        strncat(text, line.text, line.len);
+        if (i != end) strcat(text, "\n");
+    }
+    return text;
+}
+
+static void bench_copy(int lines) {
+    Buffer buf;
+    buffer_init(&buf);
+    fill(&buf, lines, 79);
+    int last = buf.line_count - 1;
+
+    double t0 = now();
+    size_t len;
+    char *text = buffer_copy_range(&buf, 0, 0, last,
+                                   buffer_line(&buf, last).len, &len);
+    double t_copy = now() - t0;
+    free(text);
+
+    if (lines <= STRCAT_MAX_LINES) {
+        t0 = now();
+        text = copy_strcat(&buf, 0, last);
+        double t_strcat = now() - t0;
+        free(text);
+        printf("  %8d lines  strcat %10.2f ms  memcpy %8.2f ms\n",
+               lines, t_strcat * 1000, t_copy * 1000);
+    } else {
+        printf("  %8d lines  strcat %10s     memcpy %8.2f ms\n",
+               lines, "-", t_copy * 1000);
+    }
+    buffer_free(&buf);
+}
+
+int main(int argc, char *argv[]) {
+    int line_kb = argc > 1 ? atoi(argv[1]) : 1024;
+
+    printf("%d keys on a %d KB line:\n", KEYS, line_kb);
+    bench_typing(line_kb << 10, 0);
+    bench_typing(line_kb << 10, 1);
+
+    printf("Copying a selection of 80-byte lines:\n");
+    int sizes[] = { 1000, 5000, 20000, 1000000 };
+    for (int i = 0; i < 4; i++) bench_copy(sizes[i]);
+    return 0;
+}
@@ -0,0 +1,79 @@
+/*
+ * Line storage memory benchmark.
+ *
+ * Writes a source-like file (100k lines by default), opens it, edits
+ * every line so each one gets storage of its own, and reports resident
+ * memory after each step and after the buffer is freed, along with how
+ * long freeing it takes.
+ *
+ *   make bench
+ *   ./tests/bench_memory [lines]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "buffer.h"
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static double rss_mb(void) {
+    long size = 0, pages = 0;
+    FILE *f = fopen("/proc/self/statm", "r");
+    if (f) {
+        if (fscanf(f, "%ld %ld", &size, &pages) != 2) pages = 0;
+        fclose(f);
+    }
+    return pages * (double)sysconf(_SC_PAGESIZE) / (1 << 20);
+}
+
+// Lines of 0..79 bytes, indented like code.
+static void make_file(const char *path, long lines) {
+    FILE *f = fopen(path, "w");
+    unsigned int seed = 12345;
+    for (long i = 0; i < lines; i++) {
+        seed = seed * 1103515245 + 12345;
+        int indent = (seed >> 8) % 4 * 4;
+        int len = (seed >> 16) % 64;
+        fprintf(f, "%*s", indent, "");
+        for (int k = 0; k < len; k++) fputc('a' + (k * 7 + len) % 26, f);
+        fputc('\n', f);
+    }
+    fclose(f);
+}
+
+int main(int argc, char *argv[]) {
+    long lines = argc > 1 ? atol(argv[1]) : 100000;
+    const char *path = "/tmp/liwit_bench_memory.txt";
+    make_file(path, lines);
+
+    double base = rss_mb();
+    printf("%ld lines:\n", lines);
+
+    Buffer buf;
+    buffer_open(&buf, path);
+    buffer_finish(&buf);
+    printf("  opened          %8.1f MB\n", rss_mb() - base);
+
+    for (int y = 0; y < buf.line_count; y++) {
+        int end_y, end_x;
+        buffer_insert(&buf, y, buffer_line(&buf, y).len, ";", 1,
+                      &end_y, &end_x);
+    }
+    printf("  every line edited %6.1f MB\n", rss_mb() - base);
+
+    double t0 = now();
+    buffer_free(&buf);
+    double t = now() - t0;
+    printf("  freed           %8.1f MB  in %.2f ms\n", rss_mb() - base,
+           t * 1000);
+
+    unlink(path);
+    return 0;
+}
@@ -0,0 +1,83 @@
+/*
+ * Replace-all micro-benchmark.
+ *
+ * Writes a synthetic log file (2M lines by default), loads it into a
+ * buffer and times the regex replace workers with 1, 2, 4, ... threads
+ * up to the number of CPUs, to show how the job scales with cores.
+ *
+ *   make bench
+ *   ./tests/bench_replace [lines]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "replace.h"
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void make_file(const char *path, long lines) {
+    FILE *f = fopen(path, "w");
+    unsigned int seed = 12345;
+    for (long i = 0; i < lines; i++) {
+        seed = seed * 1103515245 + 12345;
+        fprintf(f, "2026-01-%02u 12:%02u:%02u level=%s id=%u msg=\"request %ld\"\n",
+                1 + (seed >> 8) % 28, (seed >> 12) % 60, (seed >> 18) % 60,
+                (seed >> 5) % 4 ? "info" : "warn", seed % 100000, i);
+    }
+    fclose(f);
+}
+
+static void bench(Buffer *buf, int threads) {
+    ReplaceJob job;
+    char error[128];
+    double best = 1e9;
+    long matches = 0;
+
+    for (int run = 0; run < 3; run++) {
+        double t0 = now();
+        if (replace_start(&job, buf, "id=([0-9]+)", "id=<\\1>", threads,
+                          error, sizeof(error)) != 0) {
+            printf("  %s\n", error);
+            return;
+        }
+        replace_wait(&job);
+        double t = now() - t0;
+        matches = atomic_load(&job.matches);
+        replace_free(&job);
+        if (t < best) best = t;
+    }
+
+    printf("  %2d threads  %9ld matches  %8.1f ms  %6.2f M lines/s\n",
+           threads, matches, best * 1000, buf->line_count / best / 1e6);
+}
+
+int main(int argc, char *argv[]) {
+    long lines = argc > 1 ? strtol(argv[1], NULL, 10) : 2000000;
+    char path[] = "/tmp/liwit-bench-XXXXXX";
+    int fd = mkstemp(path);
+    if (fd < 0) return 1;
+    close(fd);
+    make_file(path, lines);
+
+    Buffer buf;
+    if (buffer_open(&buf, path) != 0) return 1;
+    buffer_finish(&buf);
+    unlink(path);
+
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    printf("%d lines, %ld CPUs:\n", buf.line_count, cpus);
+    for (int threads = 1; threads <= cpus; threads *= 2) {
+        bench(&buf, threads);
+    }
+    if (cpus > 1 && (cpus & (cpus - 1)) != 0) bench(&buf, (int)cpus);
+
+    buffer_free(&buf);
+    return 0;
+}
@@ -0,0 +1,551 @@
+/*
+ * Keystroke replay benchmark.
+ *
+ * Runs the editing core without a terminal: a keystroke script is played
+ * against a file and every key is timed on its own. For each kind of key
+ * it reports the median, the 99th percentile and the worst time, how the
+ * times spread over decades, and how many allocations (malloc, calloc,
+ * realloc) one key makes on average.
+ *
+ * A script has one action per line, optionally followed by a repeat
+ * count; '#' starts a comment:
+ *
+ *   "text"        type the text, one key per character (C escapes)
+ *   Down 1000     a key by name (see key_names in editor.c)
+ *   paste "text"  a bracketed paste of the text
+ *   paste 4096    a paste of that many bytes of generated lines
+ *   find "text"   search for the text and go to the next match
+ *   goto "where"  Ctrl+G: a line number, or a byte offset after '@'
+ *   open FILE     open a file and wait for it to be indexed
+ *   load FILE     open a file and go on while it is indexed
+ *   wait          wait for the indexer and take in what it found
+ *   save          save it
+ *   close         Ctrl+W, answering yes to saving the file first (a new
+ *                 file is not saved, as if no name was given)
+ *
+ * LIWIT_RECORD=file.keys ./liwit records such a script.
+ *
+ *   make bench
+ *   ./tests/bench_replay [scenario | script.keys [file]]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <time.h>
+#include <unistd.h>
+#include "editor.h"
+
+#define MAX_OPS 32
+#define PASTE_LINE "    return columns_col(map, x) + offset;  // generated\n"
+
+// Allocations made by the calling thread. The benchmark is linked with
+// --wrap for each function, so these see every call the editor makes.
+static __thread long allocs;
+
+void *__real_malloc(size_t size);
+void *__real_calloc(size_t n, size_t size);
+void *__real_realloc(void *p, size_t size);
+
+void *__wrap_malloc(size_t size) {
+    allocs++;
+    return __real_malloc(size);
+}
+
+void *__wrap_calloc(size_t n, size_t size) {
+    allocs++;
+    return __real_calloc(n, size);
+}
+
+void *__wrap_realloc(void *p, size_t size) {
+    allocs++;
+    return __real_realloc(p, size);
+}
+
+typedef struct {
+    char name[24];
+    double *times;
+    long count;
+    long cap;
+    long allocs;
+} Op;
+
+static Op ops[MAX_OPS];
+static int op_count;
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static Op *find_op(const char *name) {
+    for (int i = 0; i < op_count; i++) {
+        if (strcmp(ops[i].name, name) == 0) return &ops[i];
+    }
+    if (op_count == MAX_OPS) return &ops[MAX_OPS - 1];
+    Op *op = &ops[op_count++];
+    snprintf(op->name, sizeof(op->name), "%s", name);
+    return op;
+}
+
+static void add_sample(Op *op, double t, long n) {
+    if (op->count == op->cap) {
+        op->cap = op->cap ? op->cap * 2 : 1024;
+        op->times = (double *)realloc(op->times, op->cap * sizeof(double));
+    }
+    op->times[op->count++] = t;
+    op->allocs += n;
+}
+
+// REPORT
+static void format_time(double t, char *out, size_t size) {
+    if (t < 1e-6) snprintf(out, size, "%5.0f ns", t * 1e9);
+    else if (t < 1e-3) snprintf(out, size, "%5.1f us", t * 1e6);
+    else if (t < 1) snprintf(out, size, "%5.1f ms", t * 1e3);
+    else snprintf(out, size, "%5.2f s ", t);
+}
+
+static int compare_times(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return x < y ? -1 : x > y;
+}
+
+static void report(void) {
+    static const char *decades[] = {"<1us", "<10us", "<100us", "<1ms",
+                                    "<10ms", "<100ms", "<1s", ">=1s"};
+    printf("  %-10s %8s %9s %9s %9s %10s\n",
+           "key", "count", "p50", "p99", "max", "allocs/key");
+    for (int i = 0; i < op_count; i++) {
+        Op *op = &ops[i];
+        qsort(op->times, op->count, sizeof(double), compare_times);
+        char p50[16], p99[16], max[16];
+        format_time(op->times[(op->count - 1) / 2], p50, sizeof(p50));
+        format_time(op->times[(op->count * 99 + 99) / 100 - 1], p99,
+                    sizeof(p99));
+        format_time(op->times[op->count - 1], max, sizeof(max));
+        printf("  %-10s %8ld %9s %9s %9s %10.1f\n", op->name, op->count,
+               p50, p99, max, (double)op->allocs / op->count);
+
+        long hist[8] = {0};
+        for (long k = 0; k < op->count; k++) {
+            int d = 0;
+            for (double limit = 1e-6; d < 7 && op->times[k] >= limit;
+                 limit *= 10) {
+                d++;
+            }
+            hist[d]++;
+        }
+        printf("  %10s", "");
+        for (int d = 0; d < 8; d++) {
+            if (hist[d]) printf(" %s:%ld", decades[d], hist[d]);
+        }
+        printf("\n");
+
+        free(op->times);
+    }
+    memset(ops, 0, sizeof(ops));
+    op_count = 0;
+}
+
+// SCRIPTS
+static char *skip_space(char *p) {
+    while (*p == ' ' || *p == '\t') p++;
+    return p;
+}
+
+// Unquote the string at p (just past its opening quote) in place.
+// Returns its length; *end is set past the closing quote.
+static size_t unquote(char *p, char **end) {
+    char *start = p;
+    char *out = p;
+    while (*p && *p != '"') {
+        if (*p == '\\' && p[1]) {
+            p++;
+            switch (*p) {
+                case 'n': *out++ = '\n'; p++; break;
+                case 't': *out++ = '\t'; p++; break;
+                case 'x': {
+                    char hex[3] = {p[1], p[1] ? p[2] : 0, 0};
+                    *out++ = (char)strtol(hex, NULL, 16);
+                    p += 3;
+                    break;
+                }
+                default: *out++ = *p++; break;
+            }
+        } else {
+            *out++ = *p++;
+        }
+    }
+    *end = *p ? p + 1 : p;
+    return out - start;
+}
+
+static long repeat_count(const char *p) {
+    long n = atol(skip_space((char *)p));
+    return n > 0 ? n : 1;
+}
+
+static char *generate_paste(size_t len) {
+    char *text = (char *)malloc(len + 1);
+    size_t line = strlen(PASTE_LINE);
+    for (size_t at = 0; at < len; at += line) {
+        memcpy(text + at, PASTE_LINE, len - at < line ? len - at : line);
+    }
+    return text;
+}
+
+static void type_text(EditorState *ed, const char *text, size_t len) {
+    Op *op = find_op("type");
+    for (size_t i = 0; i < len; ) {
+        int n = utf8_sequence_length((unsigned char)text[i]);
+        if (n == 0 || i + n > len) n = 1;
+        long a0 = allocs;
+        double t0 = now();
+        if (text[i] == '\n') insert_newline(ed);
+        else type_char(ed, text + i, n);
+        add_sample(op, now() - t0, allocs - a0);
+        i += n;
+    }
+}
+
+static void paste(EditorState *ed, const char *text, size_t len) {
+    long a0 = allocs;
+    double t0 = now();
+    paste_text(ed, text, len);
+    add_sample(find_op("paste"), now() - t0, allocs - a0);
+}
+
+// The replies to closing a modified file: yes, save it, and an empty
+// "Save as" name for a new file.
+static int answer_yes(EditorState *ed, const char *question) {
+    (void)ed;
+    (void)question;
+    return 1;
+}
+
+static void save_named(EditorState *ed) {
+    if (ed->filename) write_file(ed);
+}
+
+static void wait_index(EditorState *ed) {
+    long a0 = allocs;
+    double t0 = now();
+    buffer_finish(&ed->buf);
+    sync_buffer(ed);
+    add_sample(find_op("index"), now() - t0, allocs - a0);
+}
+
+static int run_line(EditorState *ed, char *line) {
+    line[strcspn(line, "\r\n")] = '\0';
+    char *p = skip_space(line);
+    if (*p == '\0' || *p == '#') return 0;
+
+    if (*p == '"') {
+        char *end;
+        char *text = p + 1;
+        size_t len = unquote(text, &end);
+        for (long n = repeat_count(end); n > 0; n--) type_text(ed, text, len);
+        return 0;
+    }
+
+    char *word = p;
+    p += strcspn(p, " \t");
+    if (*p) *p++ = '\0';
+    p = skip_space(p);
+
+    if (strcmp(word, "paste") == 0) {
+        if (*p == '"') {
+            char *end;
+            size_t len = unquote(p + 1, &end);
+            paste(ed, p + 1, len);
+        } else {
+            size_t len = (size_t)atol(p);
+            char *text = generate_paste(len);
+            paste(ed, text, len);
+            free(text);
+        }
+    } else if (strcmp(word, "open") == 0 || strcmp(word, "load") == 0) {
+        long a0 = allocs;
+        double t0 = now();
+        int failed = open_file(ed, p);
+        add_sample(find_op("open"), now() - t0, allocs - a0);
+        if (failed) {
+            fprintf(stderr, "cannot open %s\n", p);
+            return -1;
+        }
+        if (word[0] == 'o') wait_index(ed);
+    } else if (strcmp(word, "wait") == 0) {
+        wait_index(ed);
+    } else if (strcmp(word, "goto") == 0) {
+        char *end;
+        if (*p == '"') p[unquote(p + 1, &end) + 1] = '\0';
+        long a0 = allocs;
+        double t0 = now();
+        int failed = go_to(ed, *p == '"' ? p + 1 : p);
+        add_sample(find_op("goto"), now() - t0, allocs - a0);
+        if (failed) {
+            fprintf(stderr, "goto: not a line or offset: %s\n", p);
+            return -1;
+        }
+    } else if (strcmp(word, "find") == 0) {
+        char *end;
+        size_t len = *p == '"' ? unquote(p + 1, &end) : 0;
+        SearchHit hit;
+        search_set_query(&ed->search, &ed->buf, p + 1, len);
+        if (search_next(&ed->search, &ed->buf, ed->cursor_y, ed->cursor_x, 1,
+                        &hit)) {
+            ed->cursor_y = hit.y;
+            ed->cursor_x = hit.x;
+        }
+    } else if (strcmp(word, "save") == 0) {
+        if (!ed->filename) {
+            fprintf(stderr, "save: no file is open\n");
+            return -1;
+        }
+        long a0 = allocs;
+        double t0 = now();
+        int failed = write_file(ed);
+        add_sample(find_op("save"), now() - t0, allocs - a0);
+        if (failed) return -1;
+    } else if (strcmp(word, "close") == 0) {
+        long a0 = allocs;
+        double t0 = now();
+        int quit = close_tab(ed);
+        add_sample(find_op("close"), now() - t0, allocs - a0);
+        if (ed->tab_count < 1 || (quit && ed->modified)) {
+            fprintf(stderr, "close: unsaved changes were dropped\n");
+            return -1;
+        }
+    } else {
+        int ch = key_code(word);
+        if (ch < 0) {
+            fprintf(stderr, "unknown key: %s\n", word);
+            return -1;
+        }
+        Op *op = find_op(word);
+        for (long n = repeat_count(p); n > 0; n--) {
+            long a0 = allocs;
+            double t0 = now();
+            edit_key(ed, ch);
+            add_sample(op, now() - t0, allocs - a0);
+        }
+    }
+    return 0;
+}
+
+// Play a script in a fresh editor of a 50x160 terminal.
+static int run_script(const char *title, char *script) {
+    EditorState ed;
+    editor_init(&ed, 50, 160);
+    ed.ask = answer_yes;
+    ed.save = save_named;
+
+    int failed = 0;
+    double t0 = now();
+    for (char *line = strtok(script, "\n"); line && !failed;
+         line = strtok(NULL, "\n")) {
+        failed = run_line(&ed, line) != 0;
+    }
+    printf("%s (%.2f s):\n", title, now() - t0);
+    report();
+    editor_free(&ed);
+    return failed;
+}
+
+// A recorded script, after opening file if one is given.
+static int run_file(const char *path, const char *file) {
+    FILE *f = fopen(path, "r");
+    if (!f) {
+        fprintf(stderr, "cannot read %s\n", path);
+        return 1;
+    }
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    rewind(f);
+
+    char head[512] = "";
+    if (file) snprintf(head, sizeof(head), "open %s\n", file);
+    size_t len = strlen(head);
+    char *text = (char *)malloc(len + size + 1);
+    memcpy(text, head, len);
+    len += fread(text + len, 1, size, f);
+    text[len] = '\0';
+    fclose(f);
+
+    int failed = run_script(path, text);
+    free(text);
+    return failed;
+}
+
+// SCENARIOS
+static char *script;
+static size_t script_len;
+
+static void add(const char *fmt, ...) {
+    char line[512];
+    va_list ap;
+    va_start(ap, fmt);
+    int n = vsnprintf(line, sizeof(line), fmt, ap);
+    va_end(ap);
+    script = (char *)realloc(script, script_len + n + 2);
+    memcpy(script + script_len, line, n);
+    script_len += n;
+    script[script_len++] = '\n';
+    script[script_len] = '\0';
+}
+
+// Source-like lines of 0..79 bytes, about 40 on average, made once
+// per size and deleted at exit.
+static char *made[8];
+static int made_count;
+
+static const char *make_file(size_t mb) {
+    char path[64];
+    snprintf(path, sizeof(path), "/tmp/liwit_bench_replay_%zu.txt", mb);
+    for (int i = 0; i < made_count; i++) {
+        if (strcmp(made[i], path) == 0) return made[i];
+    }
+
+    size_t block = 1 << 20;
+    char *text = (char *)malloc(block + 128);
+    size_t len = 0;
+    unsigned int seed = 12345;
+    while (len < block) {
+        seed = seed * 1103515245 + 12345;
+        int indent = (seed >> 8) % 4 * 4;
+        int n = (seed >> 16) % 64;
+        len += sprintf(text + len, "%*s", indent, "");
+        for (int k = 0; k < n; k++) text[len++] = 'a' + (k * 7 + n) % 26;
+        text[len++] = '\n';
+    }
+
+    FILE *f = fopen(path, "w");
+    for (size_t i = 0; i < mb; i++) fwrite(text, 1, len, f);
+    fclose(f);
+    free(text);
+    return made[made_count++] = strdup(path);
+}
+
+static int scenario(const char *name, const char *only) {
+    if (only && strcmp(name, only) != 0) return 0;
+    script_len = 0;
+    char title[64];
+
+    if (strcmp(name, "typing") == 0) {
+        add("open %s", make_file(1));
+        add("Down 10000");
+        for (int i = 0; i < 400; i++) {
+            add("\"    int total = count_words(line, len) + %d;\"", i);
+            add("Enter");
+        }
+        add("Backspace 2000");
+        snprintf(title, sizeof(title), "typing, 1 MB file");
+    } else if (strcmp(name, "enter") == 0) {
+        add("open %s", make_file(100));
+        add("Enter 100000");
+        add("Backspace 100000");
+        snprintf(title, sizeof(title), "Enter storm, 100 MB file");
+    } else if (strcmp(name, "paste") == 0) {
+        add("open %s", make_file(100));
+        add("Down 1000000");
+        add("paste %d", 32 << 20);
+        add("Ctrl+Z");
+        add("Ctrl+Y");
+        snprintf(title, sizeof(title), "32 MB paste, 100 MB file");
+    } else if (strcmp(name, "cut") == 0) {
+        add("open %s", make_file(100));
+        add("Down 100000");
+        add("F2");
+        add("Down 500000");
+        add("Ctrl+X");
+        add("Ctrl+V");
+        add("Ctrl+Z");
+        snprintf(title, sizeof(title), "cut of 500k lines, 100 MB file");
+    } else if (strcmp(name, "select") == 0) {
+        add("open %s", make_file(100));
+        add("Shift+PgDn 100000");
+        add("Ctrl+C");
+        add("End");
+        add("Ctrl+V");
+        add("Ctrl+Z");
+        add("Alt+Shift+Right 16");
+        add("Alt+Shift+Down 100000");
+        add("Ctrl+C");
+        add("Ctrl+V");
+        add("Ctrl+A");
+        add("Ctrl+C");
+        snprintf(title, sizeof(title), "copy of 1M lines, 100 MB file");
+    } else if (strcmp(name, "cursors") == 0) {
+        add("open %s", make_file(1));
+        add("F2");
+        add("Down 9999");
+        add("Ctrl+L");
+        add("\"// \"");
+        add("Backspace 3");
+        add("Enter");
+        add("Backspace");
+        add("End");
+        add("\";\"");
+        add("Down 5");
+        add("Ctrl+Z");
+        add("find \"ahov\"");
+        add("Ctrl+D");
+        add("\"x\"");
+        add("Delete");
+        add("paste \"/* found */\"");
+        snprintf(title, sizeof(title), "10k cursors, then 30k, 1 MB file");
+    } else if (strcmp(name, "jump") == 0) {
+        add("load %s", make_file(100));
+        add("goto \"@90000000\"");
+        add("wait");
+        add("goto \"2000000\"");
+        add("Ctrl+End");
+        add("Ctrl+Home");
+        add("PgDn 1000");
+        add("PgUp 1000");
+        add("goto \"1000000\"");
+        add("Enter 1000");
+        add("goto \"@60000000\"");
+        add("goto \"@10\"");
+        snprintf(title, sizeof(title), "jumps while indexing, 100 MB file");
+    } else if (strcmp(name, "close") == 0) {
+        // The last tab, a new file: its save is cancelled, so it stays.
+        add("\"unsaved text\"");
+        add("close");
+        add("Enter");
+        add("close");
+        snprintf(title, sizeof(title), "closing the last tab, save cancelled");
+    } else {
+        size_t mb = strcmp(name, "open1m") == 0 ? 1 :
+                    strcmp(name, "open100m") == 0 ? 100 : 1024;
+        add("open %s", make_file(mb));
+        add("\"x\"");
+        add("save");
+        snprintf(title, sizeof(title), "open and save, %zu MB file", mb);
+    }
+    return run_script(title, script);
+}
+
+int main(int argc, char *argv[]) {
+    static const char *names[] = {"typing", "enter", "paste", "cut",
+                                  "select", "cursors", "jump", "close",
+                                  "open1m", "open100m", "open1g"};
+    int count = sizeof(names) / sizeof(names[0]);
+    const char *only = argc > 1 ? argv[1] : NULL;
+
+    int known = 0;
+    for (int i = 0; only && i < count; i++) known |= !strcmp(only, names[i]);
+    if (only && !known) return run_file(argv[1], argc > 2 ? argv[2] : NULL);
+
+    int failed = 0;
+    for (int i = 0; i < count; i++) failed |= scenario(names[i], only);
+
+    for (int i = 0; i < made_count; i++) {
+        unlink(made[i]);
+        free(made[i]);
+    }
+    free(script);
+    return failed;
+}
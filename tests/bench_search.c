@@ -0,0 +1,81 @@
+/*
+ * Substring search micro-benchmark.
+ *
+ * Searches a synthetic file image (256 MB by default) for needles that
+ * never occur, so every byte is examined, and reports how fast each
+ * available finder gets through it, next to glibc's memmem().
+ *
+ *   make bench
+ *   ./tests/bench_search [size_mb]
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "search.h"
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// Lines of 0..159 printable bytes, like a mix of code and log output.
+static char *make_image(size_t size) {
+    char *data = (char *)malloc(size);
+    unsigned int seed = 12345;
+    size_t pos = 0;
+
+    while (pos < size) {
+        seed = seed * 1103515245 + 12345;
+        size_t len = (seed >> 16) % 160;
+        for (size_t i = 0; i < len && pos < size; i++) {
+            data[pos++] = 'a' + (i * 7 + len) % 26;
+        }
+        if (pos < size) data[pos++] = '\n';
+    }
+    return data;
+}
+
+static void bench(const char *name, const char *data, size_t size,
+                  const char *needle) {
+    size_t m = strlen(needle);
+    int libc = strcmp(name, "libc") == 0;
+    if (!libc && search_use_scanner(name) != 0) {
+        printf("  %-8s  (not supported on this CPU)\n", name);
+        return;
+    }
+
+    double best = 1e9;
+    for (int run = 0; run < 3; run++) {
+        double t0 = now();
+        const char *p = libc ? memmem(data, size, needle, m) :
+                               search_memmem(data, size, needle, m);
+        double t = now() - t0;
+        if (p) printf("  unexpected match at %zu\n", (size_t)(p - data));
+        if (t < best) best = t;
+    }
+
+    printf("  %-8s  %8.1f ms  %6.2f GB/s\n",
+           name, best * 1000, size / best / 1e9);
+}
+
+int main(int argc, char *argv[]) {
+    size_t size_mb = argc > 1 ? strtoul(argv[1], NULL, 10) : 256;
+    size_t size = size_mb << 20;
+    const char *names[] = { "avx2", "sse2", "memchr", "libc" };
+    // Rare first byte, and a common one that makes the filter work hard.
+    const char *needles[] = { "XYZZY", "abcdefgh!" };
+
+    char *data = make_image(size);
+    for (int n = 0; n < 2; n++) {
+        printf("%zu MB, needle \"%s\":\n", size_mb, needles[n]);
+        for (int i = 0; i < 4; i++) {
+            bench(names[i], data, size, needles[n]);
+        }
+    }
+    free(data);
+    return 0;
+}
@@ -0,0 +1,160 @@
+/*
+ * LIWIT - Linux-Windows Text Editor
+ * Copyright (C) 2026  Khud Bakhtiyar Iqbal Sofi
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include "trace.h"
+
+typedef struct {
+    long start;                // Nanoseconds, monotonic clock
+    long dur;
+    int phase;
+    int tid;                   // 0 for key-to-paint, which has its own track
+} TraceEvent;
+
+static const char *phase_names[TRACE_PHASES] = {
+    "input", "dispatch", "edit", "draw", "refresh", "key to paint"
+};
+
+// GLOBALS
+int trace_enabled = 0;
+
+static char *trace_path;           // Trace file, NULL if none is written
+static TraceEvent *events;         // Ring of TRACE_EVENTS spans
+static atomic_long event_head;     // Spans recorded so far
+static long window[TRACE_PHASES][TRACE_WINDOW];
+static atomic_long window_head[TRACE_PHASES];
+static long key_pending;           // Oldest key not yet painted, 0 if none
+static long origin;                // Time 0 of the trace file
+static __thread int thread_id;
+
+// RECORDING
+long trace_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000L + ts.tv_nsec;
+}
+
+// Record from here on. Spans are also kept for a trace file if path is
+// given; it is written by trace_stop().
+void trace_start(const char *path) {
+    if (!origin) origin = trace_now();
+    if (path && !trace_path) {
+        trace_path = strdup(path);
+        events = (TraceEvent *)calloc(TRACE_EVENTS, sizeof(TraceEvent));
+    }
+    trace_enabled = 1;
+}
+
+// Stop recording, unless a trace file is being written.
+void trace_pause(void) {
+    trace_enabled = trace_path != NULL;
+    key_pending = 0;
+}
+
+void trace_record(int phase, long start, long end) {
+    long w = atomic_fetch_add_explicit(&window_head[phase], 1,
+                                       memory_order_relaxed);
+    window[phase][w % TRACE_WINDOW] = end - start;
+    if (!events) return;
+
+    if (!thread_id) thread_id = (int)syscall(SYS_gettid);
+    long n = atomic_fetch_add_explicit(&event_head, 1, memory_order_relaxed);
+    TraceEvent *e = &events[n % TRACE_EVENTS];
+    e->start = start;
+    e->dur = end - start;
+    e->phase = phase;
+    e->tid = phase == TRACE_KEY_TO_PAINT ? 0 : thread_id;
+}
+
+// A key was read. Keys that arrive before the screen is next painted
+// are timed from the first of them.
+void trace_key(void) {
+    if (trace_enabled && !key_pending) key_pending = trace_now();
+}
+
+// The screen went out to the terminal.
+void trace_painted(void) {
+    if (!key_pending) return;
+    trace_record(TRACE_KEY_TO_PAINT, key_pending, trace_now());
+    key_pending = 0;
+}
+
+// STATISTICS
+static int compare_longs(const void *a, const void *b) {
+    long x = *(const long *)a, y = *(const long *)b;
+    return x < y ? -1 : x > y;
+}
+
+// Percentiles of the last TRACE_WINDOW spans of a phase.
+void trace_stats(int phase, TraceStats *stats) {
+    long head = atomic_load(&window_head[phase]);
+    long n = head < TRACE_WINDOW ? head : TRACE_WINDOW;
+    memset(stats, 0, sizeof(TraceStats));
+    if (n == 0) return;
+
+    long sorted[TRACE_WINDOW];
+    memcpy(sorted, window[phase], n * sizeof(long));
+    qsort(sorted, n, sizeof(long), compare_longs);
+    stats->count = n;
+    stats->p50 = sorted[(n - 1) / 2];
+    stats->p99 = sorted[(n * 99 + 99) / 100 - 1];
+    stats->max = sorted[n - 1];
+}
+
+// TRACE FILE
+// Chrome's trace event format: one complete ("X") event per span, times
+// in microseconds.
+static void write_trace(FILE *f) {
+    long head = atomic_load(&event_head);
+    long first = head > TRACE_EVENTS ? head - TRACE_EVENTS : 0;
+    int pid = (int)getpid();
+
+    fprintf(f, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    fprintf(f, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,"
+               "\"tid\":0,\"args\":{\"name\":\"key to paint\"}}", pid);
+    for (long n = first; n < head; n++) {
+        TraceEvent *e = &events[n % TRACE_EVENTS];
+        fprintf(f, ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":%d,"
+                   "\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}",
+                phase_names[e->phase], pid, e->tid,
+                (e->start - origin) / 1e3, e->dur / 1e3);
+    }
+    fprintf(f, "\n]}\n");
+}
+
+// Write the trace file, if one was asked for, and stop.
+void trace_stop(void) {
+    trace_enabled = 0;
+    if (trace_path) {
+        FILE *f = fopen(trace_path, "w");
+        if (f) {
+            write_trace(f);
+            fclose(f);
+        }
+    }
+    free(trace_path);
+    free(events);
+    trace_path = NULL;
+    events = NULL;
+}
@@ -0,0 +1,80 @@
+/*
+ * LIWIT - Linux-Windows Text Editor
+ * Copyright (C) 2026  Khud Bakhtiyar Iqbal Sofi
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Latency instrumentation.
+ *
+ * The main loop and the edit path time their phases: reading a key,
+ * dispatching it, changing the buffer, drawing and sending the screen
+ * out. Each span goes into a ring of recent events, from which the
+ * whole session can be written out as a Chrome trace (chrome://tracing,
+ * ui.perfetto.dev), and into a rolling window per phase for the
+ * percentiles shown on the status bar. Slots are claimed with one atomic
+ * add, so any thread may record without a lock.
+ *
+ * Off, the only cost is the test of trace_enabled at each span.
+ */
+
+#ifndef LIWIT_TRACE_H
+#define LIWIT_TRACE_H
+
+// CONFIGURATION
+#define TRACE_EVENTS (1 << 18)     // Spans kept for the trace file
+#define TRACE_WINDOW 512           // Recent spans per phase in the stats
+
+enum {
+    TRACE_INPUT,               // Waiting for and reading a key
+    TRACE_DISPATCH,            // Applying it
+    TRACE_EDIT,                // Changing the buffer
+    TRACE_DRAW,                // Drawing into the curses windows
+    TRACE_REFRESH,             // Sending the screen to the terminal
+    TRACE_KEY_TO_PAINT,        // From a key to the screen showing it
+    TRACE_PHASES
+};
+
+// DATA STRUCTURES
+typedef struct {
+    long count;                // Spans in the window
+    long p50;                  // Nanoseconds
+    long p99;
+    long max;
+} TraceStats;
+
+// GLOBALS
+extern int trace_enabled;
+
+// PROTOTYPES
+void trace_start(const char *path);
+void trace_pause(void);
+void trace_stop(void);
+long trace_now(void);
+void trace_record(int phase, long start, long end);
+void trace_key(void);
+void trace_painted(void);
+void trace_stats(int phase, TraceStats *stats);
+
+// Start of a span, 0 while tracing is off.
+static inline long trace_begin(void) {
+    return trace_enabled ? trace_now() : 0;
+}
+
+static inline void trace_end(int phase, long start) {
+    if (trace_enabled && start) trace_record(phase, start, trace_now());
+}
+
+#endif
@@ -0,0 +1,239 @@
+/*
+ * LIWIT - Linux-Windows Text Editor
+ * Copyright (C) 2026  Khud Bakhtiyar Iqbal Sofi
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "undo.h"
+#include "utf8.h"
+
+// INITIALIZATION & CLEANUP
+void undo_init(UndoLog *log, size_t budget) {
+    memset(log, 0, sizeof(UndoLog));
+    log->budget = budget;
+    log->next_group = 1;
+}
+
+static void entry_free(UndoLog *log, UndoEntry *e) {
+    log->bytes -= sizeof(UndoEntry) + e->cap;
+    free(e->text);
+}
+
+void undo_free(UndoLog *log) {
+    for (int i = log->first; i < log->count; i++) {
+        entry_free(log, &log->entries[i]);
+    }
+    free(log->entries);
+    log->entries = NULL;
+}
+
+void undo_clear(UndoLog *log) {
+    size_t budget = log->budget;
+    undo_free(log);
+    undo_init(log, budget);
+}
+
+// RECORDING
+// Forget the oldest groups until the log fits its budget again. The
+// entries in the array are moved down once half of it is unused. A group
+// still being recorded is only dropped once it is closed, whole.
+static void enforce_budget(UndoLog *log) {
+    while (log->bytes > log->budget && log->first < log->count) {
+        int group = log->entries[log->first].group;
+        if (log->group_depth > 0 && group == log->group) break;
+        while (log->first < log->count &&
+               log->entries[log->first].group == group) {
+            entry_free(log, &log->entries[log->first++]);
+        }
+    }
+    if (log->pos < log->first) log->pos = log->first;
+    if (log->saved_pos < log->first) log->saved_pos = -1;
+
+    if (log->first > 0 && log->first >= log->count / 2) {
+        int n = log->count - log->first;
+        memmove(log->entries, log->entries + log->first,
+                n * sizeof(UndoEntry));
+        log->count -= log->first;
+        log->pos -= log->first;
+        if (log->saved_pos >= 0) log->saved_pos -= log->first;
+        log->first = 0;
+    }
+}
+
+static void entry_append(UndoLog *log, UndoEntry *e, const char *text,
+                         size_t len, int front) {
+    if (e->len + len > e->cap) {
+        size_t cap = e->cap ? e->cap * 2 : 16;
+        while (cap < e->len + len) cap *= 2;
+        log->bytes += cap - e->cap;
+        e->text = (char *)realloc(e->text, cap);
+        e->cap = cap;
+    }
+    if (front) {
+        memmove(e->text + len, e->text, e->len);
+        memcpy(e->text, text, len);
+    } else {
+        memcpy(e->text + e->len, text, len);
+    }
+    e->len += len;
+}
+
+// Try to fold a one-character change into the previous entry: typing
+// continues where the last insert ended, backspace stops just before
+// the last delete, and Delete keeps removing at the same spot.
+static int try_merge(UndoLog *log, int type, int y, int x, int end_x,
+                     const char *text, size_t len) {
+    if (log->sealed || log->group_depth > 0 || log->pos == log->first ||
+        *text == '\n') {
+        return 0;
+    }
+
+    UndoEntry *e = &log->entries[log->pos - 1];
+    if (!e->merge || e->type != type || e->y != y) return 0;
+
+    if (type == UNDO_INSERT && x == e->end_x) {
+        entry_append(log, e, text, len, 0);
+        e->end_x += len;
+        return 1;
+    }
+    if (type == UNDO_DELETE && end_x == e->x) {
+        entry_append(log, e, text, len, 1);
+        e->x = x;
+        return 1;
+    }
+    if (type == UNDO_DELETE && x == e->x) {
+        entry_append(log, e, text, len, 0);
+        e->end_x += len;
+        return 1;
+    }
+    return 0;
+}
+
+void undo_record(UndoLog *log, int type, int y, int x, int end_y, int end_x,
+                 const char *text, size_t len, int cursor_y, int cursor_x) {
+    if (len == 0) return;
+
+    // A new change drops whatever could have been redone.
+    for (int i = log->pos; i < log->count; i++) {
+        entry_free(log, &log->entries[i]);
+    }
+    log->count = log->pos;
+    if (log->saved_pos > log->pos) log->saved_pos = -1;
+
+    // One character, of however many bytes, can join the entry before.
+    int one_char = len == (size_t)utf8_sequence_length((unsigned char)*text);
+    if (one_char && try_merge(log, type, y, x, end_x, text, len)) {
+        enforce_budget(log);
+        return;
+    }
+
+    if (log->count == log->cap) {
+        log->cap = log->cap ? log->cap * 2 : 64;
+        log->entries = (UndoEntry *)realloc(log->entries,
+                                            log->cap * sizeof(UndoEntry));
+    }
+
+    UndoEntry *e = &log->entries[log->count++];
+    memset(e, 0, sizeof(UndoEntry));
+    e->type = type;
+    e->group = log->group_depth > 0 ? log->group : log->next_group++;
+    e->merge = one_char && *text != '\n' && log->group_depth == 0;
+    e->y = y;
+    e->x = x;
+    e->end_y = end_y;
+    e->end_x = end_x;
+    e->cursor_y = cursor_y;
+    e->cursor_x = cursor_x;
+    log->bytes += sizeof(UndoEntry);
+    entry_append(log, e, text, len, 0);
+
+    log->pos = log->count;
+    log->sealed = 0;
+    enforce_budget(log);
+}
+
+// Changes recorded between begin and end are undone as one.
+void undo_begin_group(UndoLog *log) {
+    if (log->group_depth++ == 0) log->group = log->next_group++;
+}
+
+void undo_end_group(UndoLog *log) {
+    if (log->group_depth > 0 && --log->group_depth == 0) enforce_budget(log);
+}
+
+// Start a new entry with the next change (after the cursor moved away).
+void undo_seal(UndoLog *log) {
+    log->sealed = 1;
+}
+
+// UNDO & REDO
+// Both return the first line changed, or -1 if there was nothing to do.
+int undo_undo(UndoLog *log, Buffer *buf, int *cursor_y, int *cursor_x) {
+    if (log->pos == log->first) return -1;
+
+    int group = log->entries[log->pos - 1].group;
+    int top = buf->line_count;
+
+    while (log->pos > log->first && log->entries[log->pos - 1].group == group) {
+        UndoEntry *e = &log->entries[--log->pos];
+        if (e->type == UNDO_INSERT) {
+            buffer_delete_range(buf, e->y, e->x, e->end_y, e->end_x);
+        } else {
+            int end_y, end_x;
+            buffer_insert(buf, e->y, e->x, e->text, e->len, &end_y, &end_x);
+        }
+        *cursor_y = e->cursor_y;
+        *cursor_x = e->cursor_x;
+        if (e->y < top) top = e->y;
+    }
+    log->sealed = 1;
+    return top;
+}
+
+int undo_redo(UndoLog *log, Buffer *buf, int *cursor_y, int *cursor_x) {
+    if (log->pos == log->count) return -1;
+
+    int group = log->entries[log->pos].group;
+    int top = buf->line_count;
+
+    while (log->pos < log->count && log->entries[log->pos].group == group) {
+        UndoEntry *e = &log->entries[log->pos++];
+        if (e->type == UNDO_INSERT) {
+            buffer_insert(buf, e->y, e->x, e->text, e->len,
+                          cursor_y, cursor_x);
+        } else {
+            buffer_delete_range(buf, e->y, e->x, e->end_y, e->end_x);
+            *cursor_y = e->y;
+            *cursor_x = e->x;
+        }
+        if (e->y < top) top = e->y;
+    }
+    log->sealed = 1;
+    return top;
+}
+
+// SAVE STATE
+// Typing right after a save must not merge into the saved entry, or
+// undoing it would skip past the saved text.
+void undo_mark_saved(UndoLog *log) {
+    log->saved_pos = log->pos;
+    log->sealed = 1;
+}
+
+int undo_is_saved(UndoLog *log) {
+    return log->pos == log->saved_pos;
+}
@@ -0,0 +1,90 @@
+/*
+ * LIWIT - Linux-Windows Text Editor
+ * Copyright (C) 2026  Khud Bakhtiyar Iqbal Sofi
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Undo history.
+ *
+ * Every change to a buffer is either "text inserted at (y, x)" or "text
+ * deleted at (y, x)", so the history is a log of those two operations
+ * with the text involved. Undoing one replays its inverse, which costs
+ * as much as the change itself whatever the size of the file.
+ *
+ * Single characters typed or deleted in a row are merged into one entry.
+ * Entries sharing a group number (e.g. the delete and insert of an
+ * overwrite) are undone together. When the log grows past its memory
+ * budget the oldest groups are forgotten.
+ */
+
+#ifndef LIWIT_UNDO_H
+#define LIWIT_UNDO_H
+
+#include <stddef.h>
+#include "buffer.h"
+
+// CONFIGURATION
+#define UNDO_BUDGET (64 << 20)     // Default memory budget in bytes
+
+#define UNDO_INSERT 0
+#define UNDO_DELETE 1
+
+// DATA STRUCTURES
+typedef struct {
+    int type;                  // UNDO_INSERT or UNDO_DELETE
+    int group;                 // Entries of one group are undone together
+    int merge;                 // 1 if typing may still extend this entry
+    int y, x;                  // Start of the text
+    int end_y, end_x;          // End of the text
+    int cursor_y, cursor_x;    // Cursor before the change
+    char *text;                // Inserted or deleted text
+    size_t len;
+    size_t cap;
+} UndoEntry;
+
+typedef struct {
+    UndoEntry *entries;
+    int first;                 // Oldest entry still kept
+    int count;                 // Entries recorded (redo stops here)
+    int pos;                   // Entries before pos are applied
+    int cap;
+    size_t bytes;              // Memory held by kept entries
+    size_t budget;
+    int next_group;
+    int group;                 // Open group, or 0
+    int group_depth;
+    int sealed;                // 1 to keep typing out of the last entry
+    int saved_pos;             // pos when the file was saved, -1 if lost
+} UndoLog;
+
+// PROTOTYPES
+void undo_init(UndoLog *log, size_t budget);
+void undo_free(UndoLog *log);
+void undo_clear(UndoLog *log);
+
+void undo_record(UndoLog *log, int type, int y, int x, int end_y, int end_x,
+                 const char *text, size_t len, int cursor_y, int cursor_x);
+void undo_begin_group(UndoLog *log);
+void undo_end_group(UndoLog *log);
+void undo_seal(UndoLog *log);
+
+int undo_undo(UndoLog *log, Buffer *buf, int *cursor_y, int *cursor_x);
+int undo_redo(UndoLog *log, Buffer *buf, int *cursor_y, int *cursor_x);
+
+void undo_mark_saved(UndoLog *log);
+int undo_is_saved(UndoLog *log);
+
+#endif
@@ -0,0 +1,199 @@
+/*
+ * LIWIT - Linux-Windows Text Editor
+ * Copyright (C) 2026  Khud Bakhtiyar Iqbal Sofi
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#define _XOPEN_SOURCE 700  // wcwidth()
+#include <stdlib.h>
+#include <string.h>
+#include "utf8.h"
+
+#define REPLACEMENT_CHAR 0xFFFD
+
+// DECODING
+// Bytes in a sequence starting with `lead`, or 0 if it cannot start one.
+int utf8_sequence_length(unsigned char lead) {
+    if (lead < 0x80) return 1;
+    if (lead >= 0xC2 && lead <= 0xDF) return 2;
+    if (lead >= 0xE0 && lead <= 0xEF) return 3;
+    if (lead >= 0xF0 && lead <= 0xF4) return 4;
+    return 0;
+}
+
+// Decode the character at byte i into *wc and return its length. An
+// invalid or cut-off sequence decodes as U+FFFD, one byte long.
+int utf8_decode(const char *s, int len, int i, wchar_t *wc) {
+    const unsigned char *p = (const unsigned char *)s + i;
+    int n = utf8_sequence_length(p[0]);
+
+    if (n == 1) {
+        *wc = p[0];
+        return 1;
+    }
+    *wc = REPLACEMENT_CHAR;
+    if (n == 0 || i + n > len) return 1;
+
+    unsigned int c = p[0] & (0x7F >> n);
+    for (int k = 1; k < n; k++) {
+        if ((p[k] & 0xC0) != 0x80) return 1;
+        c = (c << 6) | (p[k] & 0x3F);
+    }
+
+    // Overlong forms, UTF-16 surrogates and code points past U+10FFFF
+    if ((n == 3 && c < 0x800) || (n == 4 && c < 0x10000) ||
+        (c >= 0xD800 && c <= 0xDFFF) || c > 0x10FFFF) {
+        return 1;
+    }
+    *wc = (wchar_t)c;
+    return n;
+}
+
+// Start of the character after the one at byte i.
+int utf8_next(const char *s, int len, int i) {
+    if (i >= len) return len;
+    wchar_t wc;
+    return i + utf8_decode(s, len, i, &wc);
+}
+
+// Start of the character before byte i.
+int utf8_prev(const char *s, int i) {
+    if (i <= 0) return 0;
+    int start = i - 1;
+    while (start > 0 && i - start < 4 &&
+           ((unsigned char)s[start] & 0xC0) == 0x80) {
+        start--;
+    }
+    // Only a sequence that ends exactly at i is one character.
+    wchar_t wc;
+    if (utf8_decode(s, i, start, &wc) == i - start) return start;
+    return i - 1;
+}
+
+// Columns taken by wc when it starts at column col.
+int utf8_char_width(wchar_t wc, int col) {
+    if (wc == '\t') return TAB_WIDTH - col % TAB_WIDTH;
+    if (wc < 0x20 || wc == 0x7F) return 1;  // Shown as U+FFFD
+    int w = wcwidth(wc);
+    return w < 0 ? 1 : w;
+}
+
+// Columns taken by a whole string.
+int utf8_width(const char *s, int len) {
+    int col = 0;
+    for (int i = 0; i < len; ) {
+        wchar_t wc;
+        i += utf8_decode(s, len, i, &wc);
+        col += utf8_char_width(wc, col);
+    }
+    return col;
+}
+
+// COLUMN MAPS
+void columns_init(ColumnCache *cache) {
+    memset(cache, 0, sizeof(ColumnCache));
+    for (int i = 0; i < COLUMN_CACHE_LINES; i++) cache->maps[i].y = -1;
+}
+
+void columns_free(ColumnCache *cache) {
+    for (int i = 0; i < COLUMN_CACHE_LINES; i++) free(cache->maps[i].cols);
+    columns_init(cache);
+}
+
+// Lines from..to changed (or moved); forget their maps.
+void columns_invalidate(ColumnCache *cache, int from, int to) {
+    for (int i = 0; i < COLUMN_CACHE_LINES; i++) {
+        ColumnMap *m = &cache->maps[i];
+        if (m->y >= from && m->y <= to) m->y = -1;
+    }
+}
+
+static int is_plain(const char *s, int len) {
+    for (int i = 0; i < len; i++) {
+        unsigned char c = (unsigned char)s[i];
+        if (c >= 0x80 || c == '\t') return 0;
+    }
+    return 1;
+}
+
+static void map_build(ColumnMap *m, Line line) {
+    m->len = line.len;
+    if (is_plain(line.text, line.len)) {
+        m->width = line.len;
+        free(m->cols);
+        m->cols = NULL;
+        m->cap = 0;
+        return;
+    }
+
+    if (line.len + 1 > m->cap) {
+        free(m->cols);
+        m->cap = line.len + 1;
+        m->cols = (int *)malloc(m->cap * sizeof(int));
+    }
+
+    int col = 0;
+    for (int i = 0; i < line.len; ) {
+        wchar_t wc;
+        int n = utf8_decode(line.text, line.len, i, &wc);
+        for (int k = 0; k < n; k++) m->cols[i + k] = col;
+        col += utf8_char_width(wc, col);
+        i += n;
+    }
+    m->cols[line.len] = col;
+    m->width = col;
+}
+
+// Column map of line y, built on first use.
+const ColumnMap *columns_get(ColumnCache *cache, Buffer *buf, int y) {
+    ColumnMap *m = &cache->maps[y % COLUMN_CACHE_LINES];
+    if (m->y != y) {
+        map_build(m, buffer_line(buf, y));
+        m->y = y;
+    }
+    return m;
+}
+
+// Column where the character holding byte x starts.
+int columns_col(const ColumnMap *map, int x) {
+    if (x < 0) return 0;
+    if (x > map->len) x = map->len;
+    return map->cols ? map->cols[x] : x;
+}
+
+// Byte where the character covering column col starts (the end of the
+// line past its last column).
+int columns_byte(const ColumnMap *map, int col) {
+    if (col <= 0) return 0;
+    if (col >= map->width) return map->len;
+    if (!map->cols) return col;
+
+    // Last byte at or before col, then the first byte of its character.
+    int lo = 0, hi = map->len;
+    while (lo < hi) {
+        int mid = lo + (hi - lo + 1) / 2;
+        if (map->cols[mid] <= col) lo = mid;
+        else hi = mid - 1;
+    }
+    int start = map->cols[lo];
+    hi = lo;
+    lo = 0;
+    while (lo < hi) {
+        int mid = lo + (hi - lo) / 2;
+        if (map->cols[mid] < start) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo;
+}
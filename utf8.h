@@ -0,0 +1,71 @@
+/*
+ * LIWIT - Linux-Windows Text Editor
+ * Copyright (C) 2026  Khud Bakhtiyar Iqbal Sofi
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*
+ * UTF-8 text and display columns.
+ *
+ * The buffer stores bytes and the cursor is a byte offset; the screen
+ * has columns, and a character may take zero, one or two of them (or up
+ * to TAB_WIDTH for a tab). Bytes that are not valid UTF-8 show as one
+ * replacement character each.
+ *
+ * A ColumnMap holds the column of every byte of a line, so converting a
+ * cursor position either way is a lookup instead of a scan. Lines that
+ * are plain ASCII without tabs need no map at all. Maps are kept for a
+ * few recently used lines and dropped when those lines change.
+ */
+
+#ifndef LIWIT_UTF8_H
+#define LIWIT_UTF8_H
+
+#include <wchar.h>
+#include "buffer.h"
+
+// CONFIGURATION
+#define TAB_WIDTH 8                // Columns between tab stops
+#define COLUMN_CACHE_LINES 64      // Lines whose maps are kept
+
+// DATA STRUCTURES
+typedef struct {
+    int y;                     // Line, -1 if the slot is free
+    int len;                   // Bytes in the line
+    int width;                 // Columns in the line
+    int *cols;                 // Column of each byte, NULL if it is the byte
+    int cap;
+} ColumnMap;
+
+typedef struct {
+    ColumnMap maps[COLUMN_CACHE_LINES];  // Slot y % COLUMN_CACHE_LINES
+} ColumnCache;
+
+// PROTOTYPES
+int utf8_decode(const char *s, int len, int i, wchar_t *wc);
+int utf8_next(const char *s, int len, int i);
+int utf8_prev(const char *s, int i);
+int utf8_sequence_length(unsigned char lead);
+int utf8_char_width(wchar_t wc, int col);
+int utf8_width(const char *s, int len);
+
+void columns_init(ColumnCache *cache);
+void columns_free(ColumnCache *cache);
+void columns_invalidate(ColumnCache *cache, int from, int to);
+const ColumnMap *columns_get(ColumnCache *cache, Buffer *buf, int y);
+int columns_col(const ColumnMap *map, int x);
+int columns_byte(const ColumnMap *map, int col);
+
+#endif